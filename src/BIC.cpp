@@ -6,7 +6,10 @@
  * @date 2016-11-22
  */
 #include <cmath>
+#include <vector>
 
+#include "BIC.h"
+#include "emg_batch.h"
 #include "model.h"
 
 using namespace std;
@@ -16,11 +19,12 @@ double gaussian(double x, double mu, double sigma){
    return (1.0/sqrt(2*sigma*M_PI ))*exp(-pow(x-mu,2)/(2*sigma));
 }
 
-double BIC3(double ** X, int j, int k, int i,
+double BIC3(const bin_matrix & X, int j, int k, int i,
 	    double N_pos, double N_neg,  double sigma, double lambda, double fp, double pi, double w){
 
+  const double * x 	= X[0], * f = X[1], * r = X[2];	// contiguous rows
   double N                = N_pos + N_neg;
-  double l     = X[0][k] - X[0][j];
+  double l     = x[k] - x[j];
 
   double uni_ll= LOG(pi/  (l))*N_pos + LOG((1-pi)/ (l))*N_neg;
 
@@ -28,13 +32,17 @@ double BIC3(double ** X, int j, int k, int i,
   double pi2      = (N_pos+10000) / (N_neg + N_pos+20000);
 
   double emg_ll   = 0, p1=0.0,p2=0.0;
-  EMG EMG_clf(X[0][i], sigma, lambda, w, pi2  );
+  emg_params EMG_clf;
+  EMG_clf.mu = x[i], EMG_clf.si = sigma, EMG_clf.l = lambda, EMG_clf.w = w, EMG_clf.pi = pi2;
   EMG_clf.foot_print      = fp;
+  vector<double> e1(k-j), e2(k-j);	// EMG::pdf over the window, both strands
+  emg_batch(EMG_clf, x+j, k-j, 1, e1.data(), NULL, NULL);
+  emg_batch(EMG_clf, x+j, k-j, -1, e2.data(), NULL, NULL);
   
   for (int i = j; i < k;i++ ){
-    p1 = EMG_clf.pdf(X[0][i],1) + (1.0-w)*pi*(1.0/l) , p2 = EMG_clf.pdf(X[0][i],-1) + (1.0-w)*(1.0-pi)*(1.0/l) ;
+    p1 = e1[i-j] + (1.0-w)*pi*(1.0/l) , p2 = e2[i-j] + (1.0-w)*(1.0-pi)*(1.0/l) ;
     if (p1 > 0 and p2 > 0 ){//this should always evalulate!!
-      emg_ll+=LOG( p1 )*X[1][i] + LOG( p2 )*X[2][i];
+      emg_ll+=LOG( p1 )*f[i] + LOG( p2 )*r[i];
     }else{
     }
   }
@@ -42,6 +50,39 @@ double BIC3(double ** X, int j, int k, int i,
   return emg_ratio;
 }
 
+/**
+ * @brief BIC3() with the EMG densities read from a kernel table rather
+ * than evaluated per bin; falls back to BIC3() if a bin is off the table.
+ * @param K template (sigma, lambda, foot_print) on the bin lattice
+ */
+double BIC3(const bin_matrix & X, const emg_kernel & K, int j, int k, int i,
+	    double N_pos, double N_neg, double pi, double w){
+
+  const double * x 	= X[0], * f = X[1], * r = X[2];
+  double N                = N_pos + N_neg;
+  double l     = x[k] - x[j];
+
+  double uni_ll= LOG(pi/  (l))*N_pos + LOG((1-pi)/ (l))*N_neg;
+
+  double pi2      = (N_pos+10000) / (N_neg + N_pos+20000);
+
+  double emg_ll   = 0, p1=0.0,p2=0.0, e1, e2;
+  int d;
+  for (int m = j; m < k; m++ ){
+    if (not K.offset(x[m] - x[i], d)){
+      return BIC3(X, j, k, i, N_pos, N_neg, K.sigma, K.lambda, K.foot_print, pi, w);
+    }
+    e1 = K.pdf(d, 1)*w*pi2, e2 = K.pdf(d, -1)*w*(1-pi2);	// as EMG::pdf
+    e1 = (e1 < pow(10,7)) ? e1 : 0.0, e2 = (e2 < pow(10,7)) ? e2 : 0.0;
+    p1 = e1 + (1.0-w)*pi*(1.0/l) , p2 = e2 + (1.0-w)*(1.0-pi)*(1.0/l) ;
+    if (p1 > 0 and p2 > 0 ){
+      emg_ll+=LOG( p1 )*f[m] + LOG( p2 )*r[m];
+    }
+  }
+  double emg_ratio        = (-2*uni_ll + LOG(N)) / (-2*emg_ll + 20*LOG(N))  ;
+  return emg_ratio;
+}
+
 /** The version below was changed in check-in 6197dad63d
  *
  *
@@ -7,4 +7,8 @@
  * 
  */
 
-double BIC3(double **, int, int, int , double, double,  double, double, double, double, double);
+#include "bin_matrix.h"
+#include "emg_kernel.h"
+
+double BIC3(const bin_matrix &, int, int, int , double, double,  double, double, double, double, double);
+double BIC3(const bin_matrix &, const emg_kernel &, int, int, int, double, double, double, double);	// X, K, j, k, i, N_pos, N_neg, pi, w
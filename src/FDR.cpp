@@ -197,52 +197,51 @@ double slice_ratio::pvalue(double y){
   return pv;
 }
 
-slice_ratio get_slice(vector<segment *> segments, int N, double CC, params * P){
-  double sigma, lambda, fp, pi, w, window, pval_threshold,ns;
- 
-  window        = stod(P->p["-pad"]), ns=stod(P->p["-ns"]) ;
-  sigma         = stod(P->p["-sigma"])/ns , lambda= ns/stod(P->p["-lambda"]);
-  fp            = stod(P->p["-foot_print"])/ns , pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
-  pval_threshold= stod(P->p["-bct"]) ;
-  int CN     = segments.size();
-  double min_x  = -1 , max_x = -1, n = 0;
-  random_device rd;
-  mt19937 mt(rd());
-  default_random_engine generator;
-  uniform_real_distribution<double> distribution(0,1);
-  vector<double> XY(N);
-  vector<double> CovN(N);
-  for (int i = 0 ; i < XY.size(); i++){
-    XY[i]=0.0, CovN[i]=0.0;
+/**
+ * @brief BIC ratio of the window around one bin, one draw of get_slice().
+ * @param data segment to sample from
+ * @param c bin at the center of the window
+ * @param CC coverage the window needs to be scored
+ * @param window half width of the window (as in get_slice)
+ * @param K template densities on the bin lattice
+ * @param pi, w template strand bias and weight
+ * @param XY the ratio, 0 if not scored (out)
+ * @param CovN coverage in the window (out)
+ * @return (void)
+ */
+void slice_sample(segment * data, int c, double CC, double window, const emg_kernel & K,
+		  double pi, double w, double & XY, double & CovN){
+  const double * x = data->X[0];
+  // j: the last bin a window or more to the left (or bin 0), k: the first
+  // bin a window or more to the right; bin c is counted on both sides
+  int j = data->find(x[c] - window), k = data->find(x[c] + window);
+  if (j == data->XN or x[c] - x[j] < window){
+    j--;
   }
-  #pragma omp parallel for
-  for (int n = 0 ; n < N ; n++){
-    double U       = distribution(mt);
-    double U2      = distribution(mt);
-    int NN         = int(U*(CN-1));
-    segment * data = segments[NN];
-    int c          = U2*int(data->XN);
-    int j = c,  k  = c;
-    double N_pos = 0 , N_neg =0 ;
-    while (j > 0 and (data->X[0][c] - data->X[0][j] )< window){
-      N_pos+=data->X[1][j];
-      N_neg+=data->X[2][j];
-      j--;
-    }
-    while (k < data->XN and (data->X[0][k] - data->X[0][c] )< window  ){
-      N_pos+=data->X[1][k];
-      N_neg+=data->X[2][k];
-      k++;
-    }
-    CovN[n] = N_pos + N_neg;
-    if (N_pos + N_neg > CC and (data->X[0][k] - data->X[0][j]) > 1.75*window  ){
-      
-      double val =  BIC3(data->X,  j,  k,  c, N_pos,  N_neg, sigma , lambda, fp , pi, w);
-      if (val >0 ){
-        XY[n]=val,CovN[n]=N_pos+N_neg;
-      }
+  j = max(j, 0);
+  double N_pos = data->sum(1, j+1, c+1) + data->sum(1, c, k);
+  double N_neg = data->sum(2, j+1, c+1) + data->sum(2, c, k);
+  XY 	= 0.0;
+  CovN 	= N_pos + N_neg;
+  if (N_pos + N_neg > CC and (x[k] - x[j]) > 1.75*window  ){
+    
+    double val =  BIC3(data->X, K, j,  k,  c, N_pos,  N_neg, pi, w);
+    if (val >0 ){
+      XY=val,CovN=N_pos+N_neg;
     }
   }
+}
+
+/**
+ * @brief Log the sampled ratios and fit the score distribution to them.
+ * @param XY sampled BIC ratios (0 == not scored)
+ * @param CovN coverage of each sample
+ * @param P parameters for this run
+ * @return the fitted slice_ratio
+ */
+slice_ratio fit_slice(const vector<double> & XY, const vector<double> & CovN, params * P){
+  double pval_threshold= stod(P->p["-bct"]) ;
+  double min_x  = -1 , max_x = -1;
   string job_name    = P->p["-N"];
   string log_out_dir = P->p["-log_out"];
   ofstream FHW;
@@ -276,3 +275,33 @@ slice_ratio get_slice(vector<segment *> segments, int N, double CC, params * P){
   SC.set(pval_threshold);
   return SC;
 }
+
+slice_ratio get_slice(vector<segment *> segments, int N, double CC, params * P){
+  double sigma, lambda, fp, pi, w, window, ns;
+ 
+  window        = stod(P->p["-pad"]), ns=stod(P->p["-ns"]) ;
+  sigma         = stod(P->p["-sigma"])/ns , lambda= ns/stod(P->p["-lambda"]);
+  fp            = stod(P->p["-foot_print"])/ns , pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
+  double step   = stod(P->p["-br"])/ns;
+  const emg_kernel & K = emg_kernel::get(step, sigma, lambda, fp, int(ceil(window/step)) + 1);
+  int CN     = segments.size();
+  random_device rd;
+  mt19937 mt(rd());
+  default_random_engine generator;
+  uniform_real_distribution<double> distribution(0,1);
+  vector<double> XY(N);
+  vector<double> CovN(N);
+  for (int i = 0 ; i < XY.size(); i++){
+    XY[i]=0.0, CovN[i]=0.0;
+  }
+  #pragma omp parallel for
+  for (int n = 0 ; n < N ; n++){
+    double U       = distribution(mt);
+    double U2      = distribution(mt);
+    int NN         = int(U*(CN-1));
+    segment * data = segments[NN];
+    int c          = U2*int(data->XN);
+    slice_sample(data, c, CC, window, K, pi, w, XY[n], CovN[n]);
+  }
+  return fit_slice(XY, CovN, P);
+}
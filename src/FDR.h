@@ -19,6 +19,7 @@
 
 #include "omp.h"
 
+#include "emg_kernel.h"
 #include "load.h"
 #include "model.h"
 #include "read_in_parameters.h"
@@ -71,5 +72,7 @@ class slice_ratio{
   int get_closest(double);
 };
 slice_ratio get_slice(vector<segment *> , int,double,params * P );
+void slice_sample(segment *, int, double, double, const emg_kernel &, double, double, double &, double &);
+slice_ratio fit_slice(const vector<double> &, const vector<double> &, params *);
 
 #endif
@@ -60,6 +60,7 @@ map<int, vector<classifier> > make_classifier_struct_free_model(params * P, segm
 			A[k].push_back(classifier(k, stod(P->p["-ct"]), stoi(P->p["-mi"]), stod(P->p["-max_noise"]), 
 			stod(P->p["-r_mu"]), stod(P->p["-ALPHA_0"]), stod(P->p["-BETA_0"]), stod(P->p["-ALPHA_1"]), 
 			stod(P->p["-BETA_1"]), stod(P->p["-ALPHA_2"]) , stod(P->p["-ALPHA_3"]),0 ));
+			A[k].back().tiles 	= stoi(P->p["-em_tiles"]);
 		}
 	
 	}
@@ -100,11 +101,12 @@ simple_c_free_mode::simple_c_free_mode(){}
 vector<simple_c_free_mode> transform_free_mode(bool FOUND, double ll, component * components, 
 	int K, segment * data, int i, double forward_N, double reverse_N) {
 	vector<simple_c_free_mode> SC ;
+	component none; //stands in when no fit succeeded (components is then NULL)
 	if (K==0){
-		SC.push_back(simple_c_free_mode(false, ll, components[0], K, data, i, forward_N, reverse_N));
+		SC.push_back(simple_c_free_mode(false, ll, FOUND ? components[0] : none, K, data, i, forward_N, reverse_N));
 	}
 	for (int k = 0 ; k < K; k++){
-		SC.push_back(simple_c_free_mode(FOUND, ll, components[k], K, data, i,forward_N, reverse_N));
+		SC.push_back(simple_c_free_mode(FOUND, ll, FOUND ? components[k] : none, K, data, i,forward_N, reverse_N));
 	}
 	return SC;
 
@@ -123,7 +125,7 @@ map<int, vector<simple_c_free_mode> > get_max_from_free_mode(map<int, vector<cla
 
 
 	for (it_type_A a = A.begin(); a!=A.end(); a++){
-		component * best_components;
+		component * best_components 	= NULL;
 		double best_ll 	= nINF;
 		bool FOUND 		= false;
 		int best_k 		= 0;
@@ -156,6 +158,12 @@ vector<map<int, vector<simple_c_free_mode> >> run_model_across_free_mode(vector<
 	double N 		= FSI.size();
 	double percent 	= 0;
 	int elon_move 	= stoi(P->p["-elon"]);
+	int tiles 		= stoi(P->p["-em_tiles"]);
+	double aggressiveness 	= stod(P->p["-race"]);
+	map<int, vector<long> > raced; //per K: restarts, abandoned, EM iterations
+	int warm_K 		= stoi(P->p["-warm_K"]);
+	double ms_pen 	= stod(P->p["-ms_pen"]);
+	int stopped 	= 0, skipped = 0; //intervals where -warm_K stopped below -maxK, fits left out
 	//printf("FSI.size: %d\n", FSI.size());
 	for (int i = 0 ; i < FSI.size(); i++){
 		if ((i / N) > (percent+0.05)){
@@ -173,16 +181,92 @@ vector<map<int, vector<simple_c_free_mode> >> run_model_across_free_mode(vector<
 		}
 		segment * data 	= FSI[i];
 		map<int, vector<classifier> > A 	= make_classifier_struct_free_model(P, FSI[i]);
+		double reads 	= 0;
+		for (int j = 0; j < data->XN; j++){
+			reads+=data->X[1][j] + data->X[2][j];
+		}
+		classifier * best 	= NULL; //best fit of the last K (-warm_K)
+		int short_K 		= 0; //K in a row that didn't pay their BIC penalty
 		for (it_type k = A.begin(); k!= A.end(); k++){
 			int N 	=  k->second.size();
-			#pragma omp parallel for num_threads(num_proc)	
-			for (int r = 0; r < N; r++ ){
-				A[k->first][r].fit2(data, data->centers,0,elon_move);
+			if (best != NULL and best->K + 1 == k->first){
+				//all but one restart: that one keeps random seeds, so the search
+				//isn't locked into the K-1 fit's optimum
+				for (int r = 0; r < max(N-1, 1); r++){
+					A[k->first][r].warm 	= best;
+				}
+			}
+			race R(aggressiveness, N);
+			if (aggressiveness > 0 and N > 1){
+				for (int r = 0; r < N; r++){
+					A[k->first][r].racing 	= &R;
+					A[k->first][r].lane 	= r;
+				}
+			}
+			if (tiles){ //the restarts in one batch per thread, each sharing its passes over the bins
+				int B 	= min(num_proc, N);
+				#pragma omp parallel for num_threads(num_proc)
+				for (int b = 0; b < B; b++){
+					vector<classifier *> fits;
+					for (int r = b; r < N; r+=B){
+						fits.push_back(&A[k->first][r]);
+					}
+					fit2_batch(fits, data, data->centers, 0, elon_move);
+				}
+			}else{
+				#pragma omp parallel for num_threads(num_proc)	
+				for (int r = 0; r < N; r++ ){
+					A[k->first][r].fit2(data, data->centers,0,elon_move);
+				}
+			}
+			if (A[k->first][0].racing){
+				vector<long> & C 	= raced[k->first];
+				C.resize(3, 0);
+				C[0]+=N, C[1]+=R.abandoned;
+				for (int r = 0; r < N; r++){
+					C[2]+=A[k->first][r].t;
+					A[k->first][r].racing 	= NULL;
+				}
+			}
+			if (warm_K and k->first > 0){
+				classifier * top 	= NULL;
+				for (int r = 0; r < N; r++){
+					if (A[k->first][r].ll > (top == NULL ? nINF : top->ll)){
+						top 	= &A[k->first][r];
+					}
+				}
+				//early stop once -warm_K components in a row haven't paid their BIC
+				//penalty; a heuristic, not a bound: a larger K that would have scored
+				//better is never fit, so this can change the selected model
+				if (top != NULL and best != NULL and 2*(top->ll - best->ll) < log(reads)*ms_pen){
+					short_K++;
+				}else{
+					short_K 	= 0;
+				}
+				if (short_K >= warm_K){
+					it_type rest 	= k;
+					rest++;
+					stopped+=(rest != A.end());
+					for (it_type s = rest; s != A.end(); s++){
+						skipped+=s->second.size();
+					}
+					A.erase(rest, A.end());
+					break;
+				}
+				best 	= top;
 			}
 		}
 		D.push_back(get_max_from_free_mode(A, FSI[i], i));
 	}
 	LG->write("100% done\n", verbose);
+	if (warm_K){
+		LG->write("warm K: stopped below -maxK in " + to_string(stopped) + " of " + to_string(FSI.size())
+			+ " intervals (" + to_string(skipped) + " fits skipped)\n", verbose);
+	}
+	for (map<int, vector<long> >::iterator k = raced.begin(); k!=raced.end(); k++){
+		LG->write("racing, K=" + to_string(k->first) + " : abandoned " + to_string(k->second[1]) + " of "
+			+ to_string(k->second[0]) + " restarts (" + to_string(k->second[2]) + " EM iterations)\n", verbose);
+	}
 	return D;
 }
 
@@ -207,11 +291,13 @@ vector<double> compute_average_model(vector<segment *> segments, params * P){
 		printf("\nStrange Error in across_segments::compute_average_model\nIgnoring but please consult tFIT contact info\nThank You\n");
 	}
 	int XN 			= maxX/delta;
-	double ** X 	= new double*[3];
+	// the average is built directly in the segment that gets fit
+	segment * s 			= new segment("chrX", 0, maxX );
+	bin_matrix & X 	= s->X;
 	double x 		= 0;
-	X[0] 	= new double[XN],X[1] 	= new double[XN],X[2] 	= new double[XN];
+	X.resize(3, XN);	// zeroed
 	for (int i = 0 ; i < XN;i++){
-		X[0][i] 		= x,X[1][i] 		= 0,X[2][i] 		= 0 ;
+		X[0][i] 		= x;
 		x+=delta;
 	}
 	for (int s = 0 ; s < segments.size(); s++){
@@ -237,17 +323,17 @@ vector<double> compute_average_model(vector<segment *> segments, params * P){
 				stod(P->p["-r_mu"]), 10.0, 10.0, 1.0, 
 				1.0*segments.size(), 2*segments.size() , stod(P->p["-ALPHA_3"]),0 );
 		vector<double> centers 	= {10};
-		segment * s 			= new segment("chrX", 0, maxX );
-		s->X 					= X;
 		s->minX=minX, s->maxX =maxX;
 		s->XN 					= XN;
 		s->SCALE 				= stod(P->p["-ns"]);
+		s->index();
 		clf.fit2(s,centers, 0,0);
 		if (clf.ll > ll){
 			ll 			= clf.ll;
 			best_clf 	= clf; 
 		}
 	}	
+	delete s;
 
 
 	vector<double> parameters(5);
@@ -0,0 +1,384 @@
+/**
+ * @file bedgraph_reader.cpp
+ * @author Robin Dowell
+ * @brief Memory mapped, zero copy reader for bedgraph files.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "bedgraph_reader.h"
+#include "gzip_inflate.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Constructors: text_span class
+ */
+text_span::text_span(){
+	ptr = NULL, len = 0;
+}
+text_span::text_span(const char * p, size_t n){
+	ptr = p, len = n;
+}
+
+string text_span::str() const{
+	return string(ptr, len);
+}
+
+bool text_span::equals(const string & s) const{
+	return s.size()==len and (len==0 or memcmp(ptr, s.data(), len)==0);
+}
+
+bg_record::bg_record(){
+	start = 0, stop = 0, coverage = 0;
+	columns = 0, valid = false;
+}
+
+//================================================================================================
+/**
+ * @brief Constructors: bedgraph_reader class
+ */
+bedgraph_reader::bedgraph_reader(){
+	data = NULL, length = 0, pos = 0, end = 0, mapped = false, opened = false, owner = false;
+}
+
+bedgraph_reader::~bedgraph_reader(){
+	close();
+}
+
+/**
+ * @brief Map a file for reading.  Regular files are mmap'd read only and
+ * advised for sequential access; anything else is slurped into memory.
+ * gzip / BGZF compressed files are inflated into memory (see gzip_inflate.h).
+ * @param FILE path to bedgraph (optionally .gz)
+ * @return false if the file couldn't be opened or inflated
+ */
+bool bedgraph_reader::open(string FILE){
+	close();
+	int fd 	= ::open(FILE.c_str(), O_RDONLY);
+	if (fd < 0){
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st)==0 and S_ISREG(st.st_mode)){
+		length 	= st.st_size;
+		if (length > 0){
+			void * m 	= mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (m != MAP_FAILED){
+				madvise(m, length, MADV_SEQUENTIAL);
+				data 	= (const char *)m;
+				mapped 	= true;
+			}
+		}
+	}
+	if (not mapped){ // pipe, special file or mmap refused: read it all
+		size_t cap = 1<<20, n = 0;
+		char * buf 	= (char *)malloc(cap);
+		ssize_t r;
+		while (buf and (r = read(fd, buf+n, cap-n)) > 0){
+			n+=r;
+			if (n==cap){
+				cap*=2;
+				char * grown 	= (char *)realloc(buf, cap);
+				if (not grown){ free(buf); buf = NULL; break; }
+				buf 	= grown;
+			}
+		}
+		if (not buf){
+			::close(fd);
+			length 	= 0;
+			return false;
+		}
+		data 	= buf;
+		length 	= n;
+	}
+	::close(fd);
+	owner 	= true;
+	if (is_gzip(data, length)){
+		char * text;
+		size_t n;
+		bool ok 	= gzip_inflate(data, length, text, n);
+		close();
+		if (not ok){
+			return false;
+		}
+		data = text, length = n, owner = true;
+	}
+	pos = 0, end = length, opened = true;
+	return true;
+}
+
+/**
+ * @brief Share the buffer of another open reader, e.g. so each thread can
+ * read its own range of one file.  Nothing is copied; other must stay open
+ * for as long as this reader is used.
+ * @param other an open reader
+ * @return false if other is not open
+ */
+bool bedgraph_reader::attach(const bedgraph_reader & other){
+	close();
+	if (not other.opened){
+		return false;
+	}
+	data = other.data, length = other.length, mapped = other.mapped;
+	pos = 0, end = length, opened = true, owner = false;
+	return true;
+}
+
+void bedgraph_reader::close(){
+	if (data != NULL and owner){
+		if (mapped){
+			munmap((void *)data, length);
+		}else{
+			free((void *)data);
+		}
+	}
+	data = NULL, length = 0, pos = 0, end = 0, mapped = false, opened = false, owner = false;
+}
+
+bool bedgraph_reader::is_open() const{
+	return opened;
+}
+
+/**
+ * @brief Tokenize the next line in place.
+ * Note a record is returned even when the line is malformed (rec.valid
+ * is false), so callers can report the offending line.
+ * @param rec filled in; spans point into the mapped file
+ * @return false once the end of the file (or seek range) is reached
+ */
+bool bedgraph_reader::next(bg_record & rec){
+	if (pos >= end){
+		return false;
+	}
+	const char * b 	= data + pos;
+	const char * nl = (const char *)memchr(b, '\n', end-pos);
+	const char * e 	= (nl==NULL) ? data+end : nl;
+	pos 	= (nl==NULL) ? end : (nl - data) + 1;
+	parse_bedgraph_line(b, e, rec);
+	return true;
+}
+
+/**
+ * @brief Return the next line without tokenizing it (for quick scans).
+ * @param line the line, without its newline or a trailing carriage return
+ * @return false once the end of the file (or seek range) is reached
+ */
+bool bedgraph_reader::next_line(text_span & line){
+	if (pos >= end){
+		return false;
+	}
+	const char * b 	= data + pos;
+	const char * nl = (const char *)memchr(b, '\n', end-pos);
+	const char * e 	= (nl==NULL) ? data+end : nl;
+	pos 	= (nl==NULL) ? end : (nl - data) + 1;
+	if (e > b and *(e-1)=='\r'){
+		e--;
+	}
+	line 	= text_span(b, e-b);
+	return true;
+}
+
+size_t bedgraph_reader::offset() const{
+	return pos;
+}
+
+/**
+ * @brief Restrict reading to a byte range of the file, e.g. a block of
+ * lines recorded earlier with offset().  begin should be the start of a line.
+ */
+void bedgraph_reader::seek(size_t begin, size_t stop){
+	end = min(stop, length);
+	pos = min(begin, end);
+}
+
+size_t bedgraph_reader::size() const{
+	return length;
+}
+
+const char * bedgraph_reader::buffer() const{
+	return data;
+}
+
+/**
+ * @brief Round a byte offset up to the start of a line, for splitting a
+ * file into chunks that hold whole lines.
+ * @param at byte offset
+ * @return at if a line starts there, else the start of the next line (or size())
+ */
+size_t bedgraph_reader::line_start(size_t at) const{
+	if (at==0 or at >= length){
+		return min(at, length);
+	}
+	if (data[at-1]=='\n'){
+		return at;
+	}
+	const char * nl = (const char *)memchr(data + at, '\n', length - at);
+	return (nl==NULL) ? length : (nl - data) + 1;
+}
+
+//================================================================================================
+/**
+ * @brief Split one line on tabs without copying and parse the numbers.
+ * Mirrors the old string_split + stoi/stod path: exactly four columns are
+ * required; a trailing carriage return is ignored.
+ * @param b first character of the line
+ * @param e one past the last character (the newline)
+ * @param rec output record
+ * @return rec.valid
+ */
+bool parse_bedgraph_line(const char * b, const char * e, bg_record & rec){
+	if (e > b and *(e-1)=='\r'){
+		e--;
+	}
+	rec.line 	= text_span(b, e-b);
+	const char * cols[4];
+	const char * ends[4];
+	int n 		= 0;
+	const char * s 	= b;
+	while (true){
+		const char * t 	= (const char *)memchr(s, '\t', e-s);
+		const char * f 	= (t==NULL) ? e : t;
+		if (n < 4){
+			cols[n] = s, ends[n] = f;
+		}
+		n++;
+		if (t==NULL){ break; }
+		s 	= t+1;
+	}
+	rec.columns 	= n;
+	rec.valid 		= false;
+	if (n != 4){
+		return false;
+	}
+	rec.chrom 	= text_span(cols[0], ends[0]-cols[0]);
+	rec.valid 	= (parse_int(cols[1], ends[1], rec.start) and parse_int(cols[2], ends[2], rec.stop)
+		and parse_double(cols[3], ends[3], rec.coverage));
+	return rec.valid;
+}
+
+/**
+ * @brief Parse a base 10 integer from [b, e) (leading white space and
+ * trailing characters are ignored, like stoi).
+ * @return false if there are no digits or the value overflows an int
+ */
+bool parse_int(const char * b, const char * e, int & out){
+	while (b < e and isspace((unsigned char)*b)){ b++; }
+	bool neg 	= false;
+	if (b < e and (*b=='-' or *b=='+')){
+		neg 	= (*b=='-');
+		b++;
+	}
+	if (b==e or not isdigit((unsigned char)*b)){
+		return false;
+	}
+	long long v 	= 0;
+	while (b < e and isdigit((unsigned char)*b)){
+		v 	= v*10 + (*b-'0');
+		if (v > (long long)numeric_limits<int>::max()+1){
+			return false;
+		}
+		b++;
+	}
+	if (neg){ v = -v; }
+	if (v > numeric_limits<int>::max() or v < numeric_limits<int>::min()){
+		return false;
+	}
+	out 	= int(v);
+	return true;
+}
+
+/**
+ * @brief Parse a decimal number from [b, e).
+ * Plain decimals with at most 15 significant digits and a small exponent
+ * are exact in double arithmetic and are converted directly; anything else
+ * (long mantissas, hex, inf/nan) is copied to the stack and given to strtod,
+ * so the result is always identical to stod.
+ * @return false if no number could be read
+ */
+bool parse_double(const char * b, const char * e, double & out){
+	static const double pow10[23] 	= {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+		1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	while (b < e and isspace((unsigned char)*b)){ b++; }
+	const char * s 	= b;
+	bool neg 		= false;
+	if (s < e and (*s=='-' or *s=='+')){
+		neg 	= (*s=='-');
+		s++;
+	}
+	uint64_t m 	= 0;
+	int digits 	= 0, exp10 = 0;
+	bool any 	= false, fast = true;
+	while (s < e and isdigit((unsigned char)*s)){
+		any 	= true;
+		if (m or *s!='0'){
+			if (digits < 19){ m = m*10 + (*s-'0'); }
+			else{ exp10++; }
+			digits++;
+		}
+		s++;
+	}
+	if (s < e and *s=='.'){
+		s++;
+		while (s < e and isdigit((unsigned char)*s)){
+			any 	= true;
+			if (m or *s!='0'){
+				if (digits < 19){ m = m*10 + (*s-'0'), exp10--; }
+				digits++;
+			}else{
+				exp10--;
+			}
+			s++;
+		}
+	}
+	if (any and s < e and (*s=='e' or *s=='E')){
+		const char * t 	= s+1;
+		bool eneg 		= false;
+		if (t < e and (*t=='-' or *t=='+')){
+			eneg 	= (*t=='-');
+			t++;
+		}
+		if (t < e and isdigit((unsigned char)*t)){
+			int x 	= 0;
+			while (t < e and isdigit((unsigned char)*t)){
+				if (x < 100000){ x = x*10 + (*t-'0'); }
+				t++;
+			}
+			exp10 	+= eneg ? -x : x;
+			s 		= t;
+		}
+	}
+	if (not any or digits > 15 or exp10 > 22 or exp10 < -22 or (s < e and isalnum((unsigned char)*s))){
+		fast 	= false;
+	}
+	if (fast){
+		double v 	= double(m);
+		v 			= exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+		out 		= neg ? -v : v;
+		return true;
+	}
+	char buf[128];
+	size_t n 	= min(size_t(e-b), sizeof(buf)-1);
+	memcpy(buf, b, n);
+	buf[n] 		= '\0';
+	char * stop;
+	double v 	= strtod(buf, &stop);
+	if (stop==buf){
+		return false;
+	}
+	out 		= v;
+	return true;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file bedgraph_reader.h
+ * @author Robin Dowell
+ * @brief Memory mapped, zero copy reader for bedgraph files.
+ * Lines are tokenized in place inside the mapped file; only the numeric
+ * columns are converted and nothing is allocated per line.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef bedgraph_reader_H
+#define bedgraph_reader_H
+
+#include <stddef.h>
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief A non-owning view of characters (e.g. a column within a mapped file).
+ * Only valid as long as the reader that produced it is open.
+ */
+class text_span{
+public:
+	const char * ptr;	//!< first character
+	size_t len;	//!< number of characters
+
+	// Constructors
+	text_span();
+	text_span(const char *, size_t);
+
+	/* FUNCTIONS: */
+	string str() const;	// copy out as a string
+	bool equals(const string &) const;
+	bool operator==(const string & s) const { return equals(s); }
+	bool operator!=(const string & s) const { return not equals(s); }
+};
+
+/**
+ * @brief One line of a bedgraph file: chrom[tab]start[tab]stop[tab]coverage
+ * The spans point into the reader's buffer.
+ */
+class bg_record{
+public:
+	text_span line;		//!< the whole line, without the newline
+	text_span chrom;	//!< first column
+	int start;			//!< second column
+	int stop;			//!< third column
+	double coverage;	//!< fourth column
+	int columns;		//!< number of tab separated columns on the line
+	bool valid;			//!< four columns and all three numbers parsed
+
+	bg_record();
+};
+
+/**
+ * @brief Reads bedgraph records directly out of a memory mapped file.
+ * Falls back to reading the whole file into memory when the path can not
+ * be mapped (pipes, special files).  Several threads can read one file by
+ * attach()ing their own reader to an open one and seek()ing to a range.
+ */
+class bedgraph_reader{
+public:
+	// Constructors
+	bedgraph_reader();
+	~bedgraph_reader();
+
+	/* FUNCTIONS: */
+	bool open(string);	// map FILE (inflating .gz), false if it couldn't be opened
+	void close();
+	bool is_open() const;
+	bool next(bg_record &);	// parse the next line, false at end of file
+	bool next_line(text_span &);	// next raw line, nothing parsed
+	size_t offset() const;	// byte offset of the next line
+	void seek(size_t, size_t);	// restrict reading to [begin, end)
+	size_t size() const;	// size of the file in bytes
+	const char * buffer() const;
+	size_t line_start(size_t) const;	// first line starting at or after a byte
+	bool attach(const bedgraph_reader &);	// read another reader's buffer (not owned)
+
+private:
+	const char * data;	//!< start of the file contents
+	size_t length;		//!< bytes in data
+	size_t pos;			//!< next line starts here
+	size_t end;			//!< stop reading here
+	bool mapped;		//!< data came from mmap (vs. owned heap buffer)
+	bool opened;		//!< open() succeeded (empty files have no data)
+	bool owner;			//!< data is released by close() (false when attached)
+
+	bedgraph_reader(const bedgraph_reader &);
+	bedgraph_reader & operator=(const bedgraph_reader &);
+};
+
+bool parse_bedgraph_line(const char *, const char *, bg_record &);
+bool parse_int(const char *, const char *, int &);
+bool parse_double(const char *, const char *, double &);
+
+#endif
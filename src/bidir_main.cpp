@@ -15,20 +15,147 @@
 
 #include "density_profiler.h"
 #include "BIC.h"
+#include "bidir_stream.h"
 #include "error_stdo_logging.h"
 #include "FDR.h"
 #include "model_main.h"
 #include "MPI_comm.h"
+#include "scan_store.h"
 #include "select_main.h"
 #include "template_matching.h"
 
 using namespace std;
+
+/**
+ * @brief Last step of bidir: run the mixture model over the prelim hits (-MLE).
+ * @return 1
+ */
+static int finish_bidir(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	string job_name = P->p["-N"];
+	//===========================================================================
+	//(4) if MLE option was provided than need to run the model_main::run()
+	//
+	if (stoi(P->p["-MLE"])){
+		P->p["-k"] 	= P->p["-o"]+ job_name+ "-" + to_string(job_ID)+ "_prelim_bidir_hits.bed";
+		model_run(P, rank, nprocs,0, job_ID, LG);
+		
+	}
+	LG->write("exiting bidir module....................................done\n\n", verbose);
+	return 1;
+}
+
+/**
+ * @brief bidir -rethreshold: the hits of a saved scan (-save_scan 1) at this
+ * run's -bct and -FDR, without reading the bedgraphs.  The input, template,
+ * -pad and binning options are taken from the run that saved the scan.
+ * @return 1
+ */
+static int bidir_rethreshold(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	string job_name = P->p["-N"];
+	string FILE 	= P->p["-rethreshold"];
+	LG->write("loading saved scan......................................", verbose);
+	vector<scan_store *> parts(1, new scan_store);
+	bool ok 	= parts[0]->open(FILE);
+	for (int r = 1; ok and r < parts[0]->header().parts; r++){
+		parts.push_back(new scan_store);
+		ok 	= parts.back()->open(FILE + ".part" + to_string(r));
+	}
+	map<string, string> saved;
+	if (ok){
+		saved 	= parts[0]->parameters();
+		const char * scan_options[13] 	= {"-i", "-j", "-ij", "-chr", "-br", "-ns", "-pad",
+			"-sigma", "-lambda", "-foot_print", "-pi", "-w", "-templates"};
+		for (int o = 0; o < 13; o++){
+			P->p[scan_options[o]] 	= saved[scan_options[o]];
+		}
+		vector<vector<string> > bank;
+		ok 	= P->template_bank(bank) and bank.size() + 1 == parts[0]->header().templates;
+		if (not ok){
+			printf("%s does not match the templates it was saved with\n", FILE.c_str());
+		}else if (stoi(P->p["-FDR"]) and not parts[0]->header().fitted){
+			printf("%s was saved without -FDR 1, so has no fitted score distribution\n", FILE.c_str());
+			ok 	= false;
+		}
+	}
+	if (not ok){
+		for (int r = 0; r < parts.size(); r++){
+			delete parts[r];
+		}
+		printf("exiting...\n");
+		return 1;
+	}
+	LG->write("done\n", verbose);
+
+	const scan_header & H 	= parts[0]->header();
+	slice_ratio SC;
+	if (stoi(P->p["-FDR"])){
+		SC.mean = H.mean, SC.std = H.std;
+	}else{
+		SC.mean = 0.78, SC.std = 0.08; //this dependent on -w 0.9 !!!
+	}
+	SC.set_2(stod(P->p["-bct"]));
+	LG->write("threshold            : "+to_string(SC.threshold) + "\n" ,verbose );
+
+	vector<vector<string> > bank;
+	P->template_bank(bank);
+	if (rank==0){
+		LG->write("finding hits in the saved scan..........................", verbose);
+		double ns 		= stod(P->p["-ns"]);
+		double window 	= stod(P->p["-pad"])/ns;
+		int NT 	= bank.size() + 1;
+		vector<map<string, vector<vector<double> > > > G(NT);
+		for (int r = 0; r < parts.size(); r++){
+			const scan_store & S 	= *parts[r];
+			for (int b = 0; b < S.segments(); b++){
+				const scan_segment & B 	= S.block(b);
+				for (int t = 0; t < NT; t++){
+					vector<vector<double> > bounds;
+					collect_hits(S.x(b), int(B.bins), B.start, S.BIC(b, t), S.densities(b), S.densities_r(b),
+						SC, B.cut_f, B.cut_r, window, ns, bounds);
+					vector<vector<double> > & all 	= G[t][S.name(b)];
+					all.insert(all.end(), bounds.begin(), bounds.end());
+				}
+			}
+		}
+		LG->write("done\n", verbose);
+		for (int t = 0; t < NT; t++){
+			params Q 	= *P;
+			string name 	= job_name;
+			if (t > 0){
+				Q.use_template(bank[t-1]);
+				name 	+= "_template" + to_string(t);
+			}
+			load::write_out_bidirs(G[t], P->p["-o"], name, job_ID, &Q, 0);
+			int total 	= 0;
+			for (map<string, vector<vector<double> > >::iterator g = G[t].begin(); g != G[t].end(); g++){
+				total 	+= g->second.size();
+			}
+			if (t==0){
+				LG->write("\nThere were " +to_string(total) + " prelimary bidirectional predictions\n\n", verbose);
+			}else{
+				LG->write("There were " + to_string(total) + " prelimary bidirectional predictions for template "
+					+ to_string(t) + " (" + bank[t-1][0] + "," + bank[t-1][1] + "," + bank[t-1][2] + ")\n\n", verbose);
+			}
+		}
+	}
+	for (int r = 0; r < parts.size(); r++){
+		delete parts[r];
+	}
+	MPI_Barrier(MPI_COMM_WORLD); //the hits are written
+	return finish_bidir(P, rank, nprocs, job_ID, LG);
+}
+
 int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 
 	int verbose 	= stoi(P->p["-v"]);
 	P->p["-merge"] 	= "1";
 	
 	LG->write("\ninitializing bidir module...............................done\n", verbose);
+	if (not P->p["-rethreshold"].empty()){
+		return bidir_rethreshold(P, rank, nprocs, job_ID, LG);
+	}
 	// This appears to be parasitic -- i.e. it uses all available even 
 	// if you set it to less in your scheduler.  
 	int threads 	= omp_get_max_threads();//number of OpenMP threads that are available for use
@@ -67,7 +194,7 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 		
 		LG->write("inserting coverage data.................................",verbose);
 		vector<segment*> integrated_segments= load::insert_bedgraph_to_segment_joint(GG, 
-			forward_bedgraph, reverse_bedgraph, joint_bedgraph, rank);
+			forward_bedgraph, reverse_bedgraph, joint_bedgraph, stod(P->p["-br"]), rank);
 		LG->write("done\n", verbose);
 		LG->write("Binning/Normalizing TSS intervals.......................",verbose);
 		load::BIN(integrated_segments, stod(P->p["-br"]), stod(P->p["-ns"]),true);	
@@ -91,6 +218,19 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	P->p["-pi"] 	       = to_string(parameters[3]);
 	P->p["-w"] 	       = to_string(parameters[4]);
 
+	if (stoi(P->p["-stream"])){
+		//(2-3) index the input, then load, scan and write out a window of
+		//chromosomes at a time (bounded by -mem)
+		int total 	= bidir_stream(P, rank, nprocs, job_ID, LG);
+		if (total < 0){
+			return 1;
+		}
+		if (rank==0){
+		  LG->write("\nThere were " +to_string(total) + " prelimary bidirectional predictions\n\n", verbose);
+		}
+		return finish_bidir(P, rank, nprocs, job_ID, LG);
+	}
+
 	LG->write("loading bedgraph files..................................", verbose);
 	vector<segment *> 	segments 	= load::load_bedgraphs_total(forward_bedgraph, 
 			reverse_bedgraph, joint_bedgraph, stoi(P->p["-br"]), stof(P->p["-ns"]), 
@@ -139,9 +279,27 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	//(3a) now going to run the template matching algorithm based on pseudo-
 	//moment estimator and compute BIC ratio (basically penalized LLR)
 	LG->write("running template matching algorithm.....................", verbose);
-	double threshold 	= run_global_template_matching(segments, out_file_dir, P, SC);	
+	scan_load load;
+	vector<vector<string> > bank;
+	P->template_bank(bank);
+	score_writer * scores 	= P->p["-scores"].empty() ? NULL : new score_writer(P->p["-scores"]);
+	scan_store_writer * store 	= NULL;
+	if (stoi(P->p["-save_scan"])){
+	  store 	= new scan_store_writer(scan_store_name(out_file_dir, job_name, job_ID, rank), P->p,
+				SC.mean, SC.std, stoi(P->p["-FDR"]), nprocs, bank.size() + 1);
+	}
+	double threshold 	= run_global_template_matching(segments, out_file_dir, P, SC, scores, store, &load);	
+	if (scores != NULL and not scores->close()){
+	  printf("couldn't write all scores to %s\n", P->p["-scores"].c_str());
+	}
+	if (store != NULL and not store->close()){
+	  printf("couldn't save the scan to %s\n", scan_store_name(out_file_dir, job_name, job_ID, rank).c_str());
+	}
+	delete scores;
+	delete store;
 	//(3b) now need to send out, gather and write bidirectional intervals 
 	LG->write("done\n", verbose);
+	LG->write("\nTemplate scan load\n" + load.report() + "\n", verbose);
 	
 	LG->write("scattering predictions to other MPI processes...........", verbose);
 	int total =  MPI_comm::gather_all_bidir_predicitions(all_segments, segments , 
@@ -152,20 +310,30 @@ int bidir_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
 	if (rank==0){
 	  LG->write("\nThere were " +to_string(total) + " prelimary bidirectional predictions\n\n", verbose);
 	}
+
+	//(3c) the same for each -templates entry, into {-N}_template{n}-{ID}_prelim_bidir_hits.bed
+	for (int b = 0; b < bank.size(); b++){
+	  params Q 	= *P;
+	  Q.use_template(bank[b]);
+	  for (int i = 0; i < segments.size(); i++){
+	    swap(segments[i]->bidirectional_bounds, segments[i]->bank_bounds[b]);
+	  }
+	  total 	= MPI_comm::gather_all_bidir_predicitions(all_segments, segments , 
+			rank, nprocs, out_file_dir, job_name + "_template" + to_string(b+1), job_ID, &Q, 0);
+	  MPI_Barrier(MPI_COMM_WORLD);
+	  for (int i = 0; i < segments.size(); i++){
+	    swap(segments[i]->bidirectional_bounds, segments[i]->bank_bounds[b]);
+	  }
+	  if (rank==0){
+	    LG->write("There were " + to_string(total) + " prelimary bidirectional predictions for template "
+		      + to_string(b+1) + " (" + bank[b][0] + "," + bank[b][1] + "," + bank[b][2] + ")\n\n", verbose);
+	  }
+	}
 	
 	//===========================================================================
 	//this should conclude it all
 	LG->write("clearing allocated segment memory.......................", verbose);	
 	load::clear_segments(all_segments);
 	LG->write("done\n", verbose);
-	//===========================================================================
-	//(4) if MLE option was provided than need to run the model_main::run()
-	//
-	if (stoi(P->p["-MLE"])){
-		P->p["-k"] 	= P->p["-o"]+ job_name+ "-" + to_string(job_ID)+ "_prelim_bidir_hits.bed";
-		model_run(P, rank, nprocs,0, job_ID, LG);
-		
-	}
-	LG->write("exiting bidir module....................................done\n\n", verbose);
-	return 1;
+	return finish_bidir(P, rank, nprocs, job_ID, LG);
 }
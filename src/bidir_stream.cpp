@@ -0,0 +1,346 @@
+/**
+ * @file bidir_stream.cpp
+ * @author Robin Dowell
+ * @brief Streaming bidir: load, bin, scan and write out a window of
+ * chromosomes at a time so only the window is ever resident (-stream 1).
+ * The window holds as many chromosomes as fit in -mem megabytes.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "bidir_stream.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+#include <omp.h>
+
+#include "FDR.h"
+#include "load.h"
+#include "template_matching.h"
+
+using namespace std;
+
+/**
+ * @brief The chromosomes [first, last) of the index a process handles;
+ * the same split MPI_comm::slice_segments makes of the loaded segments.
+ */
+static void stream_slice(int N, int rank, int nprocs, int & first, int & last){
+	int count 	= N / nprocs;
+	if (count==0){
+		count 	= 1;
+	}
+	first 	= rank * count;
+	last 	= min(first + count, N);
+	if (rank==(nprocs-1)){
+		last 	= N;
+	}
+	if (first >= last){
+		first 	= last;
+	}
+}
+
+/**
+ * @brief Group consecutive chromosomes into windows that fit the budget.
+ * A chromosome larger than the budget gets a window to itself.
+ * @param index all chromosomes
+ * @param first first chromosome of this process
+ * @param last one past its last chromosome
+ * @param delta bin width (nts)
+ * @param budget bytes
+ * @return per window, the chromosome indices
+ */
+static vector<vector<int> > plan_windows(const vector<chrom_extent> & index, int first, int last,
+		double delta, double budget){
+	vector<vector<int> > windows;
+	double used 	= 0;
+	for (int i = first; i < last; i++){
+		double b 	= index[i].bytes(delta);
+		if (windows.empty() or used + b > budget){
+			windows.push_back(vector<int>());
+			used 	= 0;
+		}
+		windows.back().push_back(i);
+		used 	+= b;
+	}
+	return windows;
+}
+
+/**
+ * @brief The chromosomes of one window.
+ */
+static vector<chrom_extent> window_chroms(const vector<chrom_extent> & index, const vector<int> & w){
+	vector<chrom_extent> which;
+	for (int i = 0; i < w.size(); i++){
+		which.push_back(index[w[i]]);
+	}
+	return which;
+}
+
+/**
+ * @brief get_slice() one window at a time.
+ * The draws are made up front from a seed shared by all processes; each
+ * process scores the draws that fall on its own chromosomes and the results
+ * are summed over processes, so every process fits the same distribution.
+ * @param SC the fitted slice_ratio
+ * @return false (on every process) if any process couldn't load a window
+ */
+static bool stream_get_slice(params * P, const vector<chrom_extent> & index,
+		const vector<vector<int> > & windows, int N, double CC, slice_ratio & SC){
+	string forward_bedgraph 	= P->p["-i"];
+	string reverse_bedgraph 	= P->p["-j"];
+	string joint_bedgraph 		= P->p["-ij"];
+	double sigma, lambda, fp, pi, w, window, ns;
+	window        = stod(P->p["-pad"]), ns=stod(P->p["-ns"]) ;
+	sigma         = stod(P->p["-sigma"])/ns , lambda= ns/stod(P->p["-lambda"]);
+	fp            = stod(P->p["-foot_print"])/ns , pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
+	double step 	= stod(P->p["-br"])/ns;
+	const emg_kernel & K 	= emg_kernel::get(step, sigma, lambda, fp, int(ceil(window/step)) + 1);
+
+	unsigned int seed 	= random_device()();
+	MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+	mt19937 mt(seed);
+	uniform_real_distribution<double> distribution(0,1);
+	int CN 	= index.size();
+	vector<vector<int> > draws(CN);	// chromosome -> samples on it
+	vector<double> U2(N);
+	for (int n = 0; n < N; n++){
+		int NN 	= int(distribution(mt)*(CN-1));
+		U2[n] 	= distribution(mt);
+		draws[NN].push_back(n);
+	}
+	vector<double> XY(N, 0.0), CovN(N, 0.0);
+	int failed 	= 0;
+	for (int v = 0; v < windows.size(); v++){
+		vector<segment *> segments 	= load::load_chromosomes(forward_bedgraph, reverse_bedgraph,
+				joint_bedgraph, window_chroms(index, windows[v]), stoi(P->p["-br"]), stof(P->p["-ns"]));
+		if (segments.size() != windows[v].size()){
+			printf("couldn't load window %d for the score distribution\n", v+1);
+			load::clear_segments(segments);
+			failed 	= 1;
+			break;
+		}
+		for (int s = 0; s < segments.size(); s++){
+			segment * data 	= segments[s];
+			const vector<int> & D 	= draws[windows[v][s]];
+			#pragma omp parallel for
+			for (int d = 0; d < D.size(); d++){
+				int c 	= U2[D[d]]*int(data->XN);
+				slice_sample(data, c, CC, window, K, pi, w, XY[D[d]], CovN[D[d]]);
+			}
+		}
+		load::clear_segments(segments);
+	}
+	//the sums below are collective, so a failed load stops every process
+	MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	if (failed){
+		return false;
+	}
+	MPI_Allreduce(MPI_IN_PLACE, &XY[0], N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &CovN[0], N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	SC 	= fit_slice(XY, CovN, P);
+	return true;
+}
+
+/**
+ * @brief Append a process's part file to the hits, renumbering the ME_ IDs.
+ * @param FHW the prelim_bidir_hits file
+ * @param PART the part file (removed afterwards)
+ * @param ID next ME_ identifier (advanced past the hits copied)
+ * @return (void)
+ */
+static void merge_part(ofstream & FHW, string PART, int & ID){
+	ifstream FH(PART);
+	string line;
+	while (getline(FH, line)){
+		size_t a 	= line.find("\tME_");
+		size_t b 	= (a==string::npos) ? a : line.find('\t', a+1);
+		if (b==string::npos){
+			continue;
+		}
+		FHW<<line.substr(0, a)<<"\tME_"<<to_string(ID)<<line.substr(b)<<endl;
+		ID++;
+	}
+	FH.close();
+	remove(PART.c_str());
+}
+
+/**
+ * @brief The bidir scan with bounded memory.
+ * Chromosomes are indexed (not loaded) up front, split over MPI processes as
+ * bidir_run does, and then loaded, scanned and written out a window at a
+ * time.  Hits are appended to {-N}-{job}_prelim_bidir_hits.bed as each window
+ * finishes (other processes write part files that are merged at the end),
+ * and those of each -templates entry n to {-N}_template{n}-{job}_prelim_bidir_hits.bed.
+ * @param P parameters
+ * @param rank MPI process number
+ * @param nprocs number of MPI processes
+ * @param job_ID job number (in file names)
+ * @param LG log file
+ * @return number of bidirectional predictions (on rank 0), -1 on failure
+ */
+int bidir_stream(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	string job_name = P->p["-N"];
+	string forward_bedgraph 	= P->p["-i"];
+	string reverse_bedgraph 	= P->p["-j"];
+	string joint_bedgraph 		= P->p["-ij"];
+	string out_file_dir 		= P->p["-o"];
+	int BINS 		= stoi(P->p["-br"]);
+	double scale 	= stof(P->p["-ns"]);
+	double budget 	= stod(P->p["-mem"])*1024*1024;
+
+	LG->write("indexing bedgraph files.................................", verbose);
+	vector<chrom_extent> index 	= load::index_bedgraphs(forward_bedgraph, reverse_bedgraph,
+			joint_bedgraph, P->p["-chr"]);
+	if (index.empty()){
+		printf("exiting...\n");
+		return -1;
+	}
+	LG->write("done\n", verbose);
+	int first, last;
+	stream_slice(index.size(), rank, nprocs, first, last);
+	vector<vector<int> > windows 	= plan_windows(index, first, last, BINS, budget);
+	LG->write("chromosomes on this process: " + to_string(last-first) + " in "
+		+ to_string(windows.size()) + " window(s) of at most " + P->p["-mem"] + " MB\n", verbose);
+
+	slice_ratio SC;
+	if (stoi(P->p["-FDR"] ) ){
+		LG->write("getting likelihood score distribution...................", verbose);
+		if (not stream_get_slice(P, index, windows, pow(10,6), pow(10,4), SC)){
+			printf("exiting...\n");
+			return -1;
+		}
+		LG->write("done\n\n", verbose);
+		if (not SC.converged){
+			LG->write("converged            : False (restoring default values)\n"  ,verbose );
+		}else{
+			LG->write("converged            : True\n" ,verbose );
+		}
+		LG->write("score mean           : "+to_string(SC.mean) + "\n" ,verbose );
+		LG->write("standard Deviation   : "+to_string(SC.std ) + "\n" ,verbose );
+		LG->write("h                    : "+to_string(SC.w ) + "\n" ,verbose );
+		LG->write("threshold            : "+to_string(SC.threshold) + "\n\n" ,verbose );
+	}else{
+		SC.mean = 0.78, SC.std = 0.08; //this dependent on -w 0.9 !!!
+		SC.set_2(stod(P->p["-bct"]));
+	}
+
+	// the hits of -sigma/-lambda/-foot_print, then of each -templates entry
+	vector<vector<string> > bank;
+	P->template_bank(bank);
+	int NT 	= bank.size() + 1;
+	vector<string> HITS(NT);
+	vector<ofstream *> FHW(NT);
+	vector<int> ID(NT, 0);
+	for (int b = 0; b < NT; b++){
+		params Q 	= *P;
+		string name 	= job_name;
+		if (b > 0){
+			Q.use_template(bank[b-1]);
+			name 	+= "_template" + to_string(b);
+		}
+		HITS[b] 	= out_file_dir + name + "-" + to_string(job_ID) + "_prelim_bidir_hits.bed";
+		FHW[b] 		= new ofstream((rank==0) ? HITS[b] : HITS[b] + ".part" + to_string(rank));
+		if (rank==0){
+			*FHW[b]<<Q.get_header(1);
+		}
+	}
+	scan_load load;
+	score_writer * scores 	= P->p["-scores"].empty() ? NULL : new score_writer(P->p["-scores"]);
+	scan_store_writer * store 	= NULL;
+	if (stoi(P->p["-save_scan"])){
+		store 	= new scan_store_writer(scan_store_name(out_file_dir, job_name, job_ID, rank), P->p,
+				SC.mean, SC.std, stoi(P->p["-FDR"]), nprocs, NT);
+	}
+	//every process takes part in each window's failure check, so a window
+	//that fails to load on one process stops them all (none waits at the barrier)
+	int NW 	= windows.size();
+	MPI_Allreduce(MPI_IN_PLACE, &NW, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	int failed 	= 0;
+	for (int v = 0; v < NW and not failed; v++){
+		if (v < windows.size()){
+			vector<chrom_extent> which 	= window_chroms(index, windows[v]);
+			string names 	= "";
+			for (int i = 0; i < which.size(); i++){
+				names 	+= (i ? "," : "") + which[i].chrom;
+			}
+			LG->write("window " + to_string(v+1) + "/" + to_string(windows.size()) + " (" + names + ")\n", verbose);
+			LG->write("loading bedgraph files..................................", verbose);
+			vector<segment *> segments 	= load::load_chromosomes(forward_bedgraph, reverse_bedgraph,
+					joint_bedgraph, which, BINS, scale);
+			if (segments.size() != which.size()){
+				failed 	= 1;
+			}else{
+				LG->write("done\n", verbose);
+				LG->write("running template matching algorithm.....................", verbose);
+				run_global_template_matching(segments, out_file_dir, P, SC, scores, store, &load);
+				LG->write("done\n", verbose);
+				for (int i = 0; i < segments.size(); i++){
+					load::write_out_bidirs_chrom(*FHW[0], segments[i]->chrom, segments[i]->bidirectional_bounds, ID[0]);
+					for (int b = 1; b < NT; b++){
+						load::write_out_bidirs_chrom(*FHW[b], segments[i]->chrom, segments[i]->bank_bounds[b-1], ID[b]);
+					}
+				}
+				for (int b = 0; b < NT; b++){
+					FHW[b]->flush();
+				}
+			}
+			load::clear_segments(segments);
+		}
+		MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	}
+	for (int b = 0; b < NT; b++){
+		FHW[b]->close();
+		delete FHW[b];
+	}
+	if (scores != NULL and not scores->close() and not failed){
+		printf("couldn't write all scores to %s\n", P->p["-scores"].c_str());
+	}
+	if (store != NULL and not store->close() and not failed){
+		printf("couldn't save the scan to %s\n", scan_store_name(out_file_dir, job_name, job_ID, rank).c_str());
+	}
+	if (failed){
+		//leave nothing half written behind
+		for (int b = 0; b < NT; b++){
+			remove(((rank==0) ? HITS[b] : HITS[b] + ".part" + to_string(rank)).c_str());
+		}
+		if (scores != NULL){
+			remove(P->p["-scores"].c_str());
+		}
+		if (store != NULL){
+			remove(scan_store_name(out_file_dir, job_name, job_ID, rank).c_str());
+		}
+	}
+	delete scores;
+	delete store;
+	if (failed){
+		printf("exiting...\n");
+		return -1;
+	}
+	LG->write("\nTemplate scan load\n" + load.report() + "\n", verbose);
+	MPI_Barrier(MPI_COMM_WORLD); //make sure every part is written
+
+	if (rank==0 and nprocs > 1){
+		LG->write("merging predictions from other MPI processes............", verbose);
+		for (int b = 0; b < NT; b++){
+			ofstream FH(HITS[b], ios::app);
+			for (int r = 1; r < nprocs; r++){
+				merge_part(FH, HITS[b] + ".part" + to_string(r), ID[b]);
+			}
+			FH.close();
+		}
+		LG->write("done\n", verbose);
+	}
+	for (int b = 1; b < NT and rank==0; b++){
+		LG->write("There were " + to_string(ID[b]) + " prelimary bidirectional predictions for template "
+			+ to_string(b) + " (" + bank[b-1][0] + "," + bank[b-1][1] + "," + bank[b-1][2] + ")\n", verbose);
+	}
+	return ID[0];
+}
@@ -0,0 +1,17 @@
+/**
+ * @file bidir_stream.h
+ * @author Robin Dowell
+ * @brief Streaming bidir: a bounded window of chromosomes resident at a time.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef bidir_stream_H
+#define bidir_stream_H
+
+#include "error_stdo_logging.h"
+#include "read_in_parameters.h"
+
+int bidir_stream(params *, int, int, int, Log_File *);
+
+#endif
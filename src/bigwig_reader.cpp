@@ -0,0 +1,294 @@
+/**
+ * @file bigwig_reader.cpp
+ * @author Robin Dowell
+ * @brief Random access reader for bigWig coverage files.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "bigwig_reader.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+using namespace std;
+
+#define BW_MAX_DEPTH 64	//!< deeper trees are taken to be corrupt (cycles)
+
+static uint16_t get16(const char * p){ uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+static uint32_t get32(const char * p){ uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+static uint64_t get64(const char * p){ uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+/**
+ * @brief Constructor: bigwig_reader class (nothing mapped)
+ */
+bigwig_reader::bigwig_reader(){
+	data = NULL, length = 0, buffer = 0, index = 0;
+}
+
+bigwig_reader::~bigwig_reader(){
+	close();
+}
+
+/**
+ * @brief Map a bigWig and read its chromosome list.
+ * @param FILE path to a .bw / .bigWig file
+ * @return false if it couldn't be mapped or is not a bigWig this reader handles
+ */
+bool bigwig_reader::open(string FILE){
+	close();
+	int fd 	= ::open(FILE.c_str(), O_RDONLY);
+	if (fd < 0){
+		printf("couldn't open bigWig %s\n", FILE.c_str());
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 or st.st_size < 64){
+		::close(fd);
+		printf("%s is not a bigWig\n", FILE.c_str());
+		return false;
+	}
+	length 	= st.st_size;
+	void * m 	= mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (m == MAP_FAILED){
+		length 	= 0;
+		printf("couldn't map bigWig %s\n", FILE.c_str());
+		return false;
+	}
+	data 	= (const char *)m;
+	uint32_t magic 	= get32(data);
+	if (magic != BW_MAGIC){
+		if (magic == __builtin_bswap32(BW_MAGIC)){
+			printf("%s was written with the other byte order, which is not supported\n", FILE.c_str());
+		}else{
+			printf("%s is not a bigWig\n", FILE.c_str());
+		}
+		close();
+		return false;
+	}
+	uint64_t tree 	= get64(data + 8);
+	index 	= get64(data + 24);
+	buffer 	= get32(data + 52);
+	if (tree + 32 > length or index + 48 > length or get32(data + tree) != BW_CHROM_MAGIC
+		or get32(data + index) != BW_INDEX_MAGIC){
+		printf("bigWig %s is truncated or corrupt\n", FILE.c_str());
+		close();
+		return false;
+	}
+	uint32_t key 	= get32(data + tree + 8);
+	if (not read_chroms(tree + 32, key, 0)){
+		printf("couldn't read the chromosome list of bigWig %s\n", FILE.c_str());
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Walk the chromosome B+ tree from a node, filling names/sizes/ids.
+ * @param node file offset of the node
+ * @param key bytes per (NUL padded) name
+ * @param depth of node (guards against cycles)
+ * @return false if the tree runs off the end of the file
+ */
+bool bigwig_reader::read_chroms(uint64_t node, uint32_t key, uint32_t depth){
+	if (depth > BW_MAX_DEPTH or node + 4 > length){
+		return false;
+	}
+	bool leaf 	= data[node] != 0;
+	uint16_t count 	= get16(data + node + 2);
+	uint64_t item 	= key + 8;	// name then (id, size) or a child offset
+	if (node + 4 + count*item > length){
+		return false;
+	}
+	for (int i = 0; i < count; i++){
+		const char * p 	= data + node + 4 + i*item;
+		if (leaf){
+			uint32_t id 	= get32(p + key);
+			string chrom(p, strnlen(p, key));
+			if (id >= names.size()){
+				names.resize(id+1);
+				sizes.resize(id+1, 0);
+			}
+			names[id] 	= chrom;
+			sizes[id] 	= get32(p + key + 4);
+			ids[chrom] 	= id;
+		}else if (not read_chroms(get64(p + key), key, depth+1)){
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Unmap the file.
+ */
+void bigwig_reader::close(){
+	if (data != NULL){
+		munmap((void *)data, length);
+	}
+	data = NULL, length = 0, buffer = 0, index = 0;
+	names.clear(), sizes.clear(), ids.clear();
+}
+
+bool bigwig_reader::is_open() const {
+	return data != NULL;
+}
+
+int bigwig_reader::chroms() const {
+	return names.size();
+}
+
+string bigwig_reader::name(int c) const {
+	return names[c];
+}
+
+uint32_t bigwig_reader::size(int c) const {
+	return sizes[c];
+}
+
+/**
+ * @brief Chromosome id of a name.
+ * @return -1 if the file has no such chromosome
+ */
+int bigwig_reader::find(const string & chrom) const {
+	map<string, int>::const_iterator it 	= ids.find(chrom);
+	return (it==ids.end()) ? -1 : it->second;
+}
+
+/**
+ * @brief Does (c1, b1) come before (c2, b2)?
+ */
+static bool before(uint32_t c1, uint32_t b1, uint32_t c2, uint32_t b2){
+	return c1 < c2 or (c1 == c2 and b1 < b2);
+}
+
+/**
+ * @brief Collect the R-tree leaves under a node that overlap a region.
+ * @param node file offset of the node
+ * @param chrom chromosome id
+ * @param start first base of the region
+ * @param end one past the last base
+ * @param out leaves found, in file order
+ * @param depth of node (guards against cycles)
+ */
+void bigwig_reader::search(uint64_t node, int chrom, uint32_t start, uint32_t end,
+		vector<bw_block> & out, int depth) const {
+	if (depth > BW_MAX_DEPTH or node + 4 > length){
+		return;
+	}
+	bool leaf 	= data[node] != 0;
+	uint16_t count 	= get16(data + node + 2);
+	uint64_t item 	= leaf ? 32 : 24;
+	if (node + 4 + count*item > length){
+		return;
+	}
+	for (int i = 0; i < count; i++){
+		const char * p 	= data + node + 4 + i*item;
+		uint32_t sc = get32(p), sb = get32(p + 4), ec = get32(p + 8), eb = get32(p + 12);
+		// overlaps [start, end) of chrom?
+		if (not before(sc, sb, chrom, end) or not before(chrom, start, ec, eb)){
+			continue;
+		}
+		if (leaf){
+			bw_block B;
+			B.chrom 	= chrom;
+			B.start 	= (sc == uint32_t(chrom)) ? sb : 0;
+			B.end 		= (ec == uint32_t(chrom)) ? eb : sizes[chrom];
+			B.offset 	= get64(p + 16);
+			B.size 		= get64(p + 24);
+			out.push_back(B);
+		}else{
+			search(get64(p + 16), chrom, start, end, out, depth+1);
+		}
+	}
+}
+
+/**
+ * @brief The data blocks that may hold bases of a region, in file order.
+ * @param chrom chromosome id
+ * @param start first base of the region
+ * @param end one past the last base (e.g. size(chrom) for all of it)
+ */
+vector<bw_block> bigwig_reader::blocks(int chrom, uint32_t start, uint32_t end) const {
+	vector<bw_block> out;
+	if (data != NULL and chrom >= 0 and chrom < chroms() and start < end){
+		search(index + 48, chrom, start, end, out, 0);
+	}
+	return out;
+}
+
+/**
+ * @brief Inflate a data block and decode its items.
+ * @param B a block from blocks()
+ * @param items replaced with the block's items (of any chromosome)
+ * @return false if the block is corrupt
+ */
+bool bigwig_reader::read(const bw_block & B, vector<bw_item> & items) const {
+	items.clear();
+	if (B.offset + B.size > length){
+		return false;
+	}
+	const char * p 	= data + B.offset;
+	size_t n 		= B.size;
+	vector<char> raw;
+	if (buffer > 0){
+		raw.resize(buffer);
+		uLongf out 	= buffer;
+		if (uncompress((Bytef *)&raw[0], &out, (const Bytef *)p, n) != Z_OK){
+			return false;
+		}
+		p = &raw[0], n = out;
+	}
+	if (n < 24){
+		return false;
+	}
+	bw_item I;
+	I.chrom 	= get32(p);
+	uint32_t start 	= get32(p + 4);
+	uint32_t step 	= get32(p + 12);
+	uint32_t span 	= get32(p + 16);
+	uint8_t type 	= p[20];
+	uint16_t count 	= get16(p + 22);
+	size_t width 	= (type==1) ? 12 : (type==2) ? 8 : (type==3) ? 4 : 0;
+	if (width == 0 or 24 + count*width > n){
+		return false;
+	}
+	p 	+= 24;
+	items.reserve(count);
+	for (int i = 0; i < count; i++, p += width){
+		if (type==1){	// bedGraph: start, end, value
+			I.start = get32(p), I.end = get32(p + 4);
+			memcpy(&I.value, p + 8, sizeof(float));
+		}else if (type==2){	// variableStep: start, value
+			I.start = get32(p), I.end = I.start + span;
+			memcpy(&I.value, p + 4, sizeof(float));
+		}else{	// fixedStep: value
+			I.start = start + i*step, I.end = I.start + span;
+			memcpy(&I.value, p, sizeof(float));
+		}
+		items.push_back(I);
+	}
+	return true;
+}
+
+/**
+ * @brief Cheap check of the first bytes of a file for BW_MAGIC.
+ */
+bool bigwig_reader::is_bigwig(string FILE){
+	char magic[4] 	= {0};
+	std::FILE * FH 	= fopen(FILE.c_str(), "rb");
+	if (FH == NULL){
+		return false;
+	}
+	size_t n 	= fread(magic, 1, sizeof(magic), FH);
+	fclose(FH);
+	return n == sizeof(magic) and get32(magic) == BW_MAGIC;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file bigwig_reader.h
+ * @author Robin Dowell
+ * @brief Random access reader for bigWig coverage files.
+ * The file is memory mapped; the chromosome B+ tree is read once on open and
+ * the R-tree index is searched per region, so only the (zlib compressed)
+ * data blocks overlapping a region are ever inflated.
+ *
+ * Layout (see the UCSC bigWig specification, native byte order):
+ *   header				64 bytes, magic BW_MAGIC
+ *   zoom headers		not used here
+ *   chromosome B+ tree	name -> (id, size)
+ *   data blocks		24 byte header + items, optionally zlib compressed
+ *   R-tree index		(chrom, start)-(chrom, end) -> block offset, size
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef bigwig_reader_H
+#define bigwig_reader_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define BW_MAGIC 0x888FFC26		//!< first 4 bytes of a bigWig
+#define BW_CHROM_MAGIC 0x78CA8C91	//!< chromosome B+ tree header
+#define BW_INDEX_MAGIC 0x2468ACE0	//!< R-tree index header
+
+/**
+ * @brief One data block as listed in an R-tree leaf.
+ */
+class bw_block{
+public:
+	uint32_t chrom;		//!< chromosome id of the block's first item
+	uint32_t start;		//!< first base covered
+	uint32_t end;		//!< one past the last base covered
+	uint64_t offset;	//!< file offset of the (compressed) block
+	uint64_t size;		//!< bytes on disk
+};
+
+/**
+ * @brief One item of a data block: the bases start, ... < end at depth value.
+ * bedGraph, variableStep and fixedStep sections all decode to these.
+ */
+class bw_item{
+public:
+	uint32_t chrom;		//!< chromosome id
+	uint32_t start;		//!< first base
+	uint32_t end;		//!< one past the last base
+	float value;		//!< coverage
+};
+
+/**
+ * @brief Read only view of a mapped bigWig.  All const members may be used
+ * from several threads at once.
+ */
+class bigwig_reader{
+public:
+	// Constructors
+	bigwig_reader();
+	~bigwig_reader();
+
+	/* FUNCTIONS: */
+	bool open(string);	// map FILE, false (with a message) if not a usable bigWig
+	void close();
+	bool is_open() const;
+	int chroms() const;	// number of chromosomes
+	string name(int) const;	// chromosome id -> name
+	uint32_t size(int) const;	// chromosome id -> length
+	int find(const string &) const;	// chromosome id, -1 if absent
+	vector<bw_block> blocks(int, uint32_t, uint32_t) const;	// chrom, start, end
+	bool read(const bw_block &, vector<bw_item> &) const;	// inflate and decode a block
+
+	static bool is_bigwig(string);	// does FILE start with BW_MAGIC?
+
+private:
+	const char * data;	//!< the mapped file
+	size_t length;		//!< bytes mapped
+	uint32_t buffer;	//!< largest inflated block (0 == blocks are not compressed)
+	uint64_t index;		//!< offset of the R-tree index
+	vector<string> names;	//!< by chromosome id
+	vector<uint32_t> sizes;	//!< by chromosome id
+	map<string, int> ids;	//!< name -> chromosome id
+
+	bool read_chroms(uint64_t, uint32_t, uint32_t);	// B+ tree node, key size, depth
+	void search(uint64_t, int, uint32_t, uint32_t, vector<bw_block> &, int) const;
+
+	bigwig_reader(const bigwig_reader &);
+	bigwig_reader & operator=(const bigwig_reader &);
+};
+
+#endif
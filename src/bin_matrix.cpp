@@ -0,0 +1,140 @@
+/**
+ * @file bin_matrix.cpp
+ * @author Robin Dowell
+ * @brief Owning, aligned structure-of-arrays storage for binned data (segment::X).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "bin_matrix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+using namespace std;
+
+/**
+ * @brief rows*stride doubles on an ALIGN byte boundary, NULL if nothing to hold.
+ */
+static double * aligned_doubles(size_t n){
+	if (n == 0){
+		return NULL;
+	}
+	void * p 	= NULL;
+	if (posix_memalign(&p, bin_matrix::ALIGN, n*sizeof(double)) != 0){
+		printf("bin_matrix: unable to allocate %zu doubles\n", n);
+		throw bad_alloc();
+	}
+	return (double *)p;
+}
+
+/**
+ * @brief Number of doubles per row so every row starts on an ALIGN boundary.
+ */
+static int padded(int cols){
+	int per 	= bin_matrix::ALIGN / sizeof(double);
+	return ((max(cols, 0) + per - 1) / per) * per;
+}
+
+/**
+ * @brief Constructor: empty bin_matrix
+ */
+bin_matrix::bin_matrix() : data(NULL), nrows(0), cols(0), stride(0) {}
+
+/**
+ * @brief Constructor: r x c zeroed matrix
+ */
+bin_matrix::bin_matrix(int r, int c) : data(NULL), nrows(0), cols(0), stride(0) {
+	resize(r, c);
+}
+
+bin_matrix::bin_matrix(const bin_matrix & other) : data(NULL), nrows(0), cols(0), stride(0) {
+	*this 	= other;
+}
+
+bin_matrix::bin_matrix(bin_matrix && other) : data(NULL), nrows(0), cols(0), stride(0) {
+	swap(other);
+}
+
+bin_matrix::~bin_matrix(){
+	release();
+}
+
+/**
+ * @brief Deep copy.
+ */
+bin_matrix & bin_matrix::operator=(const bin_matrix & other){
+	if (this != &other){
+		release();
+		data 	= aligned_doubles(size_t(other.nrows)*other.stride);
+		nrows 	= other.nrows, cols = other.cols, stride = other.stride;
+		if (data){
+			memcpy(data, other.data, size_t(nrows)*stride*sizeof(double));
+		}
+	}
+	return *this;
+}
+
+/**
+ * @brief Take over other's buffer; other is left empty.
+ */
+bin_matrix & bin_matrix::operator=(bin_matrix && other){
+	if (this != &other){
+		release();
+		swap(other);
+	}
+	return *this;
+}
+
+/**
+ * @brief Reallocate as r x c, all zeros.
+ * @param r rows
+ * @param c columns
+ */
+void bin_matrix::resize(int r, int c){
+	release();
+	nrows 	= max(r, 0), cols = max(c, 0), stride = padded(c);
+	data 	= aligned_doubles(size_t(nrows)*stride);
+	if (data){
+		memset(data, 0, size_t(nrows)*stride*sizeof(double));
+	}
+}
+
+/**
+ * @brief Keep the first c columns of every row in a buffer sized to fit.
+ * @param c columns to keep (c >= size() is a no-op)
+ */
+void bin_matrix::shrink(int c){
+	c 	= max(c, 0);
+	if (c >= cols){
+		return;
+	}
+	int s 	= padded(c);
+	double * d 	= aligned_doubles(size_t(nrows)*s);
+	for (int r = 0; d and r < nrows; r++){
+		memcpy(d + size_t(r)*s, data + size_t(r)*stride, size_t(c)*sizeof(double));
+		memset(d + size_t(r)*s + c, 0, size_t(s - c)*sizeof(double));
+	}
+	free(data);
+	data 	= d, cols = c, stride = s;
+}
+
+/**
+ * @brief Free the buffer, leaving a 0 x 0 matrix.
+ */
+void bin_matrix::release(){
+	free(data);
+	data 	= NULL;
+	nrows 	= 0, cols = 0, stride = 0;
+}
+
+void bin_matrix::swap(bin_matrix & other){
+	std::swap(data, other.data);
+	std::swap(nrows, other.nrows);
+	std::swap(cols, other.cols);
+	std::swap(stride, other.stride);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file bin_matrix.h
+ * @author Robin Dowell
+ * @brief Owning, aligned structure-of-arrays storage for binned data (segment::X).
+ * All rows live in a single 64-byte aligned allocation so loops over a row
+ * touch contiguous, cache line aligned memory and the buffer is freed with
+ * its owner.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef bin_matrix_H
+#define bin_matrix_H
+
+#include <stddef.h>
+
+/**
+ * @brief A non-owning view of one row of a bin_matrix.
+ * Only valid while the matrix it came from is alive and not resized.
+ */
+class bin_span{
+public:
+	double * ptr;	//!< first element
+	int n;			//!< number of elements
+
+	// Constructors
+	bin_span() : ptr(NULL), n(0) {}
+	bin_span(double * p, int len) : ptr(p), n(len) {}
+
+	/* FUNCTIONS: */
+	double & operator[](int i) const { return ptr[i]; }
+	int size() const { return n; }
+	double * begin() const { return ptr; }
+	double * end() const { return ptr + n; }
+};
+
+/**
+ * @brief rows x cols doubles, row major, every row starting on a 64 byte boundary.
+ * X[r] gives a plain pointer to row r so X[r][i] indexing still works.
+ */
+class bin_matrix{
+public:
+	static const size_t ALIGN = 64;	//!< bytes, one cache line
+
+	// Constructors
+	bin_matrix();
+	bin_matrix(int, int);	// rows, cols (zeroed)
+	bin_matrix(const bin_matrix &);
+	bin_matrix(bin_matrix &&);
+	~bin_matrix();
+
+	bin_matrix & operator=(const bin_matrix &);
+	bin_matrix & operator=(bin_matrix &&);
+
+	/* FUNCTIONS: */
+	void resize(int, int);	// rows, cols; contents are zeroed
+	void shrink(int);	// keep the first cols columns, release the rest
+	void release();	// free the buffer
+	void swap(bin_matrix &);
+
+	double * operator[](int r) { return data + r*stride; }
+	const double * operator[](int r) const { return data + r*stride; }
+	bin_span row(int r) const { return bin_span(data + r*stride, cols); }
+	int rows() const { return nrows; }
+	int size() const { return cols; }	// columns (bins) per row
+	bool empty() const { return data == NULL; }
+
+private:
+	double * data;	//!< nrows*stride doubles
+	int nrows;		//!< number of rows
+	int cols;		//!< used columns in each row
+	int stride;		//!< doubles between row starts (cols rounded up to ALIGN)
+};
+
+#endif
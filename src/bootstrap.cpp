@@ -25,7 +25,7 @@
 
 using namespace std;
 
-int sample(double ** CDF, int XN, double sum_N, segment * NS, double pi , segment * S){
+int sample(const bin_matrix & CDF, int XN, double sum_N, segment * NS, double pi , segment * S){
 	random_device rd;
 	mt19937 MT(rd());
 	
@@ -60,20 +60,15 @@ int sample(double ** CDF, int XN, double sum_N, segment * NS, double pi , segmen
 }
 
 void subsample(segment * S, segment * NS ){
-	double ** CDF 	= new double*[3];
-	NS->X 			= new double*[3];
 	NS->minX = S->minX, NS->maxX = S->maxX;
 	NS->XN 			= S->XN;
 	NS->N 			= S->N;
 	NS->SCALE 		= S->SCALE;
 	int BINS 		= int(S->XN);
-	for (int j = 0; j < 3; j++){
-		CDF[j]=new double[BINS], NS->X[j]=new double[BINS];
-	}
+	bin_matrix CDF(3, BINS);	// zeroed
+	NS->X.resize(3, BINS);
 	for (int i = 0 ; i< S->XN; i++){
 		CDF[0][i] 	= S->X[0][i], NS->X[0][i] = S->X[0][i];
-		CDF[1][i] 	= 0,CDF[2][i] 	= 0;
-		NS->X[1][i] = 0,NS->X[2][i] = 0;		
 	}
 	double forward_sum =0, reverse_sum = 0, sum_N = 0, pi = 0;
 	for (int i = 0; i < S->XN; i++){
@@ -93,6 +88,7 @@ void subsample(segment * S, segment * NS ){
 	}
 
 	sample( CDF, S->XN, S->N, NS , pi, S);
+	NS->index();
 	
 }
 
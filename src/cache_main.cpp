@@ -0,0 +1,51 @@
+/**
+ * @file cache_main.cpp
+ * @author Robin Dowell
+ * @brief The cache module: convert bedgraph input into a .tfitcov coverage cache.
+ * Parsing the bedgraphs is then paid once; bidir and model read the cache
+ * when it is given as -ij.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "cache_main.h"
+
+#include "coverage_cache.h"
+
+using namespace std;
+
+/**
+ * @brief Write {-o}{-N}.tfitcov from -ij or -i/-j (rank 0 only).
+ * @param P parameters
+ * @param rank MPI process number
+ * @param nprocs number of MPI processes
+ * @param job_ID job number for the log file
+ * @param LG log file
+ * @return 1 on failure, 0 otherwise
+ */
+int cache_run(params * P, int rank, int nprocs, int job_ID, Log_File * LG){
+	int verbose 	= stoi(P->p["-v"]);
+	LG->write("\ninitializing cache module...............................done\n", verbose);
+	if (rank != 0){
+		return 0;
+	}
+	vector<string> FILES;
+	if (not P->p["-ij"].empty()){
+		FILES 	= {P->p["-ij"]};
+	}else{
+		FILES 	= {P->p["-i"], P->p["-j"]};
+	}
+	if (FILES.size()==1 and coverage_cache::is_cache(FILES[0])){
+		printf("%s is already a coverage cache\n", FILES[0].c_str());
+		return 1;
+	}
+	string OUT 	= P->p["-o"] + P->p["-N"] + ".tfitcov";
+	LG->write("writing coverage cache..................................", verbose);
+	if (not write_coverage_cache(FILES, OUT)){
+		printf("exiting...\n");
+		return 1;
+	}
+	LG->write("done\n", verbose);
+	LG->write("coverage cache: " + OUT + "\n", verbose);
+	return 0;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file cache_main.h
+ * @author Robin Dowell
+ * @brief The cache module: convert bedgraph input into a .tfitcov coverage cache.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef cache_main_H
+#define cache_main_H
+
+#include "error_stdo_logging.h"
+#include "read_in_parameters.h"
+
+int cache_run(params *, int, int, int, Log_File *);
+
+#endif
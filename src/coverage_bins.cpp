@@ -0,0 +1,159 @@
+/**
+ * @file coverage_bins.cpp
+ * @author Robin Dowell
+ * @brief Streaming accumulation of bedgraph coverage into fixed width bins.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "coverage_bins.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Constructor: coverage_bins class (unanchored, 1nt bins)
+ */
+coverage_bins::coverage_bins(){
+	reset(1, NAN, false);
+}
+
+/**
+ * @brief Start over with a new lattice.
+ * @param d bin width (nts)
+ * @param o genomic coordinate of bin 0; NAN to anchor on the first run
+ * @param f if true the origin never moves (bases left of it are dropped)
+ */
+void coverage_bins::reset(double d, double o, bool f){
+	delta 		= d;
+	origin 		= o;
+	anchored 	= not isnan(o);
+	fixed 		= f and anchored;
+	empty 		= true;
+	misaligned 	= false;
+	lo = 0, hi = 0;
+	forward.clear();
+	reverse.clear();
+}
+
+/**
+ * @brief Add the bases start, start+1, ... < stop, each with depth y.
+ * @param strand 1 == forward, -1 == reverse (anything else only extends lo/hi)
+ * @param start first base
+ * @param stop one past the last base
+ * @param y value (read depth assumed)
+ */
+void coverage_bins::add(int strand, double start, double stop, double y){
+	if (stop <= start){
+		return;
+	}
+	double count 	= ceil(stop - start);	// number of bases
+	double last 	= start + count - 1;
+	if (empty){
+		lo = start, hi = last;
+		empty 	= false;
+	}else{
+		lo = min(lo, start), hi = max(hi, last);
+	}
+	if (not anchored){
+		origin 		= start;
+		anchored 	= true;
+	}
+	if (misaligned){
+		return;
+	}
+	if (start < origin){
+		if (fixed){
+			// drop the bases left of the first bin
+			double k 	= ceil(origin - start);
+			if (k >= count){ return; }
+			start 	+= k, count -= k;
+		}else{
+			double shift 	= (origin - start)/delta;
+			if (shift != floor(shift)){
+				misaligned 	= true;
+				forward.clear(), reverse.clear();
+				return;
+			}
+			// move the origin left by whole bins
+			if (not forward.empty()){ forward.insert(forward.begin(), size_t(shift), 0.); }
+			if (not reverse.empty()){ reverse.insert(reverse.begin(), size_t(shift), 0.); }
+			origin 	= start;
+		}
+	}
+	if (strand != 1 and strand != -1){
+		return;
+	}
+	vector<double> & B 	= (strand==1) ? forward : reverse;
+	int b 		= int(floor((start - origin)/delta));
+	int b_last 	= int(floor((start + count - 1 - origin)/delta));
+	if (b_last >= int(B.size())){
+		B.resize(b_last+1, 0.);
+	}
+	for (; b <= b_last; b++){
+		// bases start + k in [origin + b*delta, origin + (b+1)*delta)
+		double k_lo 	= max(0.0, ceil(origin + b*delta - start));
+		double k_hi 	= min(count, ceil(origin + (b+1)*delta - start));
+		if (k_hi > k_lo){
+			B[b] 	+= y*(k_hi - k_lo);
+		}
+	}
+}
+
+/**
+ * @brief Add in the sums of another accumulator, e.g. a piece of the same
+ * chromosome binned by another thread.  Its origin must sit a whole number
+ * of bins at or right of this one's, so its bins line up with these.
+ * Sums are added bin by bin, so merging pieces in file order gives the same
+ * values as adding their runs here directly.
+ * @param other accumulator with the same delta
+ * @return false (nothing added) if the lattices don't line up
+ */
+bool coverage_bins::merge(const coverage_bins & other){
+	if (other.empty){
+		return true;
+	}
+	double shift 	= anchored ? (other.origin - origin)/delta : 0;
+	if (other.misaligned or misaligned or other.delta != delta or shift < 0 or shift != floor(shift)){
+		return false;
+	}
+	if (not anchored){
+		origin 		= other.origin;
+		anchored 	= true;
+	}
+	if (empty){
+		lo = other.lo, hi = other.hi;
+		empty 	= false;
+	}else{
+		lo = min(lo, other.lo), hi = max(hi, other.hi);
+	}
+	size_t k 	= size_t(shift);
+	const vector<double> * from[2] 	= {&other.forward, &other.reverse};
+	vector<double> * to[2] 	= {&forward, &reverse};
+	for (int s = 0; s < 2; s++){
+		const vector<double> & A 	= *from[s];
+		vector<double> & B 	= *to[s];
+		if (A.empty()){
+			continue;
+		}
+		if (k + A.size() > B.size()){
+			B.resize(k + A.size(), 0.);
+		}
+		for (size_t i = 0; i < A.size(); i++){
+			B[k+i] 	+= A[i];
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Release the bin sums (keeps the lattice and extents).
+ */
+void coverage_bins::clear(){
+	vector<double>().swap(forward);
+	vector<double>().swap(reverse);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file coverage_bins.h
+ * @author Robin Dowell
+ * @brief Streaming accumulation of bedgraph coverage into fixed width bins.
+ * Lets the loaders bin each record as it is parsed rather than keeping the
+ * raw coverage around until segment::bin().
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef coverage_bins_H
+#define coverage_bins_H
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Per strand bin sums on the lattice origin + b*delta.
+ * A base x goes into bin floor((x - origin)/delta), exactly where
+ * segment::bin() puts it when origin is the segment's first base (minX).
+ * When the origin is not known up front it is taken from the first run;
+ * runs that start further left move the origin by whole bins, or mark the
+ * accumulator misaligned when they are off the lattice (the caller must
+ * then rebuild it with reset() and the true first base, see lo).
+ */
+class coverage_bins{
+public:
+	double origin;	//!< genomic coordinate of the left edge of bin 0
+	double delta;	//!< bin width (nts)
+	bool anchored;	//!< origin has been set
+	bool fixed;		//!< origin may not move; bases left of it are dropped
+	bool empty;		//!< no runs added yet (zero coverage runs count)
+	bool misaligned;	//!< a run fell left of origin, off the lattice
+	double lo;		//!< first base seen
+	double hi;		//!< last base seen
+	vector<double> forward;	//!< bin sums, strand == 1
+	vector<double> reverse;	//!< bin sums, strand == -1
+
+	// Constructors
+	coverage_bins();
+
+	/* FUNCTIONS: */
+	void reset(double, double, bool);	// delta, origin (NAN = first run), fixed
+	void add(int, double, double, double);	// strand, start, stop, y
+	bool merge(const coverage_bins &);	// add sums binned elsewhere on this lattice
+	void clear();	// release the bins
+};
+
+#endif
@@ -0,0 +1,352 @@
+/**
+ * @file coverage_cache.cpp
+ * @author Robin Dowell
+ * @brief Binary coverage cache (.tfitcov) built once from bedgraph input.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "coverage_cache.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "bedgraph_reader.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: coverage_cache class (nothing mapped)
+ */
+coverage_cache::coverage_cache(){
+	data 	= NULL;
+	length 	= 0;
+}
+
+coverage_cache::~coverage_cache(){
+	close();
+}
+
+/**
+ * @brief Map a cache and check that it is complete.
+ * @param FILE path to a .tfitcov file
+ * @return false if it couldn't be mapped or is not a valid cache
+ */
+bool coverage_cache::open(string FILE){
+	close();
+	int fd 	= ::open(FILE.c_str(), O_RDONLY);
+	if (fd < 0){
+		printf("couldn't open coverage cache %s\n", FILE.c_str());
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 or size_t(st.st_size) < sizeof(cov_header)){
+		::close(fd);
+		printf("%s is not a coverage cache\n", FILE.c_str());
+		return false;
+	}
+	length 	= st.st_size;
+	void * m 	= mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (m == MAP_FAILED){
+		length 	= 0;
+		printf("couldn't map coverage cache %s\n", FILE.c_str());
+		return false;
+	}
+	data 	= (const char *)m;
+	const cov_header & H 	= header();
+	if (memcmp(H.magic, COV_MAGIC, sizeof(H.magic)) != 0 or H.version != COV_VERSION
+		or H.size != length or H.table + H.chroms*sizeof(cov_chrom) > length){
+		printf("%s is not a valid coverage cache (version %d expected)\n", FILE.c_str(), COV_VERSION);
+		close();
+		return false;
+	}
+	for (int c = 0; c < chroms(); c++){
+		const cov_chrom & C 	= chrom(c);
+		if (C.name > length or C.name_len > length - C.name){
+			printf("coverage cache %s is truncated\n", FILE.c_str());
+			close();
+			return false;
+		}
+		for (int s = 0; s < 2; s++){
+			if (C.offset[s] + C.count[s]*sizeof(cov_run) > length){
+				printf("coverage cache %s is truncated\n", FILE.c_str());
+				close();
+				return false;
+			}
+		}
+		index[name(c)] 	= c;
+	}
+	return true;
+}
+
+/**
+ * @brief Unmap the cache.
+ */
+void coverage_cache::close(){
+	if (data != NULL){
+		munmap((void *)data, length);
+	}
+	data 	= NULL;
+	length 	= 0;
+	index.clear();
+}
+
+int coverage_cache::chroms() const {
+	return data==NULL ? 0 : int(header().chroms);
+}
+
+const cov_header & coverage_cache::header() const {
+	return *(const cov_header *)data;
+}
+
+const cov_chrom & coverage_cache::chrom(int c) const {
+	return ((const cov_chrom *)(data + header().table))[c];
+}
+
+string coverage_cache::name(int c) const {
+	const cov_chrom & C 	= chrom(c);
+	return string(data + C.name, C.name_len);
+}
+
+/**
+ * @brief Table index of a chromosome.
+ * @return -1 if the cache has no such chromosome
+ */
+int coverage_cache::find(const string & chrom) const {
+	map<string, int>::const_iterator it 	= index.find(chrom);
+	return (it==index.end()) ? -1 : it->second;
+}
+
+/**
+ * @brief The runs of one strand of a chromosome (chrom(c).count[s] of them).
+ * @param c chromosome index
+ * @param s strand, 0 == forward, 1 == reverse
+ */
+const cov_run * coverage_cache::runs(int c, int s) const {
+	return (const cov_run *)(data + chrom(c).offset[s]);
+}
+
+/**
+ * @brief Index of the first run that may cover base x or anything after it.
+ * Runs are sorted by start and no longer than span, so earlier runs end before x.
+ * @param c chromosome index
+ * @param s strand, 0 == forward, 1 == reverse
+ * @param x genomic coordinate
+ */
+size_t coverage_cache::first_run(int c, int s, double x) const {
+	const cov_chrom & C 	= chrom(c);
+	const cov_run * R 	= runs(c, s);
+	double from 	= x - C.span[s];
+	size_t lo = 0, hi = C.count[s];
+	while (lo < hi){
+		size_t mid 	= lo + (hi - lo)/2;
+		if (R[mid].start < from){
+			lo 	= mid + 1;
+		}else{
+			hi 	= mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * @brief Cheap check of the first bytes of a file for COV_MAGIC.
+ */
+bool coverage_cache::is_cache(string FILE){
+	char magic[8] 	= {0};
+	std::FILE * FH 	= fopen(FILE.c_str(), "rb");
+	if (FH == NULL){
+		return false;
+	}
+	size_t n 	= fread(magic, 1, sizeof(magic), FH);
+	fclose(FH);
+	return n == sizeof(magic) and memcmp(magic, COV_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief What the cache needs to know about a chromosome before writing it.
+ */
+class cov_stats{
+public:
+	uint32_t flags;
+	bool any;		//!< a run with stop > start was seen
+	double lo, hi;
+	uint64_t count[2];
+	double span[2];
+	uint64_t cursor[2];	//!< next run to write (second pass)
+
+	cov_stats(){
+		flags = 0, any = false, lo = 0, hi = 0;
+		count[0] = count[1] = 0, span[0] = span[1] = 0;
+		cursor[0] = cursor[1] = 0;
+	}
+};
+
+static bool run_before(const cov_run & a, const cov_run & b){
+	return a.start < b.start;
+}
+
+/**
+ * @brief Convert bedgraph input into a .tfitcov cache.
+ * Two passes over the (memory mapped) input: the first sizes every block,
+ * the second writes the runs straight into the mapped output, so memory use
+ * does not grow with the input.
+ * @param FILES {joint} or {forward, reverse} bedgraphs
+ * @param OUT path of the cache to write
+ * @return false if the input was malformed or the output couldn't be written
+ */
+bool write_coverage_cache(vector<string> FILES, string OUT){
+	bedgraph_reader FH[2];
+	bg_record rec;
+	map<string, cov_stats> G;
+	if (FILES.empty() or FILES.size() > 2){
+		printf("coverage cache needs either -ij or both -i and -j\n");
+		return false;
+	}
+	// First pass: chromosomes, extents and how many runs per strand
+	for (size_t u = 0; u < FILES.size(); u++){
+		if (not FH[u].open(FILES[u])){
+			printf("couln't open FILE %s\n", FILES[u].c_str());
+			return false;
+		}
+		int line_number 	= 0;
+		string prevChrom 	= "";
+		cov_stats * S 	= NULL;
+		while (FH[u].next(rec)){
+			if (not rec.valid){
+				printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n",line_number, FILES[u].c_str() );
+				return false;
+			}
+			line_number++;
+			if (S==NULL or rec.chrom != prevChrom){
+				prevChrom 	= rec.chrom.str();
+				bool first 	= G.find(prevChrom)==G.end();
+				S 	= &G[prevChrom];
+				if (first){
+					S->lo = rec.start, S->hi = rec.stop;	// as segment(chrom, start, stop)
+				}
+				if (u==0){
+					S->flags 	|= COV_IN_FIRST;
+				}
+			}
+			if (rec.stop <= rec.start){
+				continue;	// covers no bases
+			}
+			double last 	= rec.start + ceil(double(rec.stop) - rec.start) - 1;
+			if (not S->any){
+				S->lo = rec.start, S->hi = last, S->any = true;
+			}else{
+				S->lo = min(S->lo, double(rec.start)), S->hi = max(S->hi, last);
+			}
+			int s 	= (u==0 and rec.coverage > 0) ? 0 : 1;
+			S->count[s]++;
+			S->span[s] 	= max(S->span[s], double(rec.stop - rec.start));
+		}
+	}
+
+	// Lay out the file
+	cov_header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, COV_MAGIC, sizeof(H.magic));
+	H.version 	= COV_VERSION;
+	H.files 	= FILES.size();
+	H.chroms 	= G.size();
+	H.table 	= sizeof(cov_header);
+	H.names 	= H.table + H.chroms*sizeof(cov_chrom);
+	uint64_t pos 	= H.names;
+	for (map<string, cov_stats>::iterator g = G.begin(); g != G.end(); g++){
+		pos 	+= g->first.size();
+	}
+	pos 	= (pos + 15) & ~uint64_t(15);
+	vector<cov_chrom> table(G.size());
+	uint64_t name 	= H.names;
+	size_t c 	= 0;
+	for (map<string, cov_stats>::iterator g = G.begin(); g != G.end(); g++, c++){
+		cov_chrom & C 	= table[c];
+		memset(&C, 0, sizeof(C));
+		C.name 	= name, C.name_len = g->first.size();
+		C.flags 	= g->second.flags;
+		C.lo 	= g->second.lo, C.hi = g->second.hi;
+		for (int s = 0; s < 2; s++){
+			C.offset[s] 	= pos;
+			C.count[s] 	= g->second.count[s];
+			C.span[s] 	= g->second.span[s];
+			g->second.cursor[s] 	= pos;
+			pos 	+= C.count[s]*sizeof(cov_run);
+		}
+		name 	+= C.name_len;
+	}
+	H.size 	= pos;
+
+	string TMP 	= OUT + ".tmp";
+	int fd 	= ::open(TMP.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 or ftruncate(fd, H.size) != 0){
+		printf("couldn't write coverage cache %s\n", OUT.c_str());
+		if (fd >= 0){ ::close(fd); }
+		return false;
+	}
+	void * m 	= mmap(NULL, H.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (m == MAP_FAILED){
+		printf("couldn't map coverage cache %s for writing\n", OUT.c_str());
+		unlink(TMP.c_str());
+		return false;
+	}
+	char * out 	= (char *)m;
+	memcpy(out, &H, sizeof(H));
+	if (not table.empty()){
+		memcpy(out + H.table, &table[0], table.size()*sizeof(cov_chrom));
+	}
+	c 	= 0;
+	for (map<string, cov_stats>::iterator g = G.begin(); g != G.end(); g++, c++){
+		memcpy(out + table[c].name, g->first.data(), g->first.size());
+	}
+
+	// Second pass: copy the runs into their blocks, in file order
+	for (size_t u = 0; u < FILES.size(); u++){
+		FH[u].seek(0, FH[u].size());
+		string prevChrom 	= "";
+		cov_stats * S 	= NULL;
+		while (FH[u].next(rec)){
+			if (S==NULL or rec.chrom != prevChrom){
+				prevChrom 	= rec.chrom.str();
+				S 	= &G[prevChrom];
+			}
+			if (rec.stop <= rec.start){
+				continue;
+			}
+			int s 	= (u==0 and rec.coverage > 0) ? 0 : 1;
+			cov_run R;
+			R.start = rec.start, R.stop = rec.stop, R.value = fabs(rec.coverage);
+			memcpy(out + S->cursor[s], &R, sizeof(R));
+			S->cursor[s] 	+= sizeof(R);
+		}
+		FH[u].close();
+	}
+	// Region lookups need each block sorted by start; sorted input already is
+	for (c = 0; c < table.size(); c++){
+		for (int s = 0; s < 2; s++){
+			cov_run * R 	= (cov_run *)(out + table[c].offset[s]);
+			cov_run * E 	= R + table[c].count[s];
+			if (not is_sorted(R, E, run_before)){
+				stable_sort(R, E, run_before);
+			}
+		}
+	}
+	bool ok 	= msync(m, H.size, MS_SYNC) == 0;
+	munmap(m, H.size);
+	if (not ok or rename(TMP.c_str(), OUT.c_str()) != 0){
+		printf("couldn't write coverage cache %s\n", OUT.c_str());
+		unlink(TMP.c_str());
+		return false;
+	}
+	return true;
+}
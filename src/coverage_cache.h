@@ -0,0 +1,108 @@
+/**
+ * @file coverage_cache.h
+ * @author Robin Dowell
+ * @brief Binary coverage cache (.tfitcov) built once from bedgraph input.
+ * The file holds a header, a chromosome table and, per chromosome and strand,
+ * a block of coverage runs (one per bedgraph line) at a known byte offset.
+ * Loaders map the file and only touch the blocks they need.
+ *
+ * Layout (native byte order, all offsets in bytes from the start of file):
+ *   cov_header
+ *   cov_chrom[chroms]		sorted by name
+ *   names				chromosome names, not NUL terminated
+ *   cov_run blocks		16 byte aligned, sorted by start within a block
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef coverage_cache_H
+#define coverage_cache_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define COV_MAGIC "TFITCOV"	//!< first 8 bytes of every cache (with the NUL)
+#define COV_VERSION 1
+
+/**
+ * @brief Fixed size header at the start of the cache.
+ */
+struct cov_header{
+	char magic[8];		//!< COV_MAGIC
+	uint32_t version;	//!< COV_VERSION
+	uint32_t files;		//!< 1 == built from -ij, 2 == built from -i and -j
+	uint64_t chroms;	//!< entries in the chromosome table
+	uint64_t table;		//!< offset of the chromosome table
+	uint64_t names;		//!< offset of the names
+	uint64_t size;		//!< total file size
+	uint64_t reserved[2];
+};
+
+/**
+ * @brief One chromosome: its extents and where its runs are.
+ * Strand 0 is forward, 1 is reverse, resolved with the loaders' rule: a line
+ * is forward only if it came from the first file and has coverage > 0.
+ */
+struct cov_chrom{
+	uint64_t name;		//!< offset of the name
+	uint32_t name_len;	//!< characters in the name
+	uint32_t flags;		//!< COV_IN_FIRST
+	double lo;			//!< first base covered (i.e. segment::minX)
+	double hi;			//!< last base covered (i.e. segment::maxX)
+	uint64_t offset[2];	//!< offset of the strand's runs
+	uint64_t count[2];	//!< number of runs on the strand
+	double span[2];		//!< longest run on the strand (bounds region lookups)
+};
+
+#define COV_IN_FIRST 1	//!< chromosome appears in the first input file
+
+/**
+ * @brief One bedgraph line: the bases start, ... < stop, each at depth value.
+ * value is |coverage|, zero coverage lines are kept (they extend lo/hi).
+ */
+struct cov_run{
+	int32_t start;
+	int32_t stop;
+	double value;
+};
+
+/**
+ * @brief Read only view of a mapped .tfitcov file.
+ */
+class coverage_cache{
+public:
+	// Constructors
+	coverage_cache();
+	~coverage_cache();
+
+	/* FUNCTIONS: */
+	bool open(string);	// map FILE, false (with a message) if not a valid cache
+	void close();
+	int chroms() const;	// number of chromosomes
+	const cov_chrom & chrom(int) const;
+	string name(int) const;
+	int find(const string &) const;	// index of a chromosome, -1 if absent
+	const cov_run * runs(int, int) const;	// chromosome, strand
+	size_t first_run(int, int, double) const;	// first run that may reach a base
+	const cov_header & header() const;
+
+	static bool is_cache(string);	// does FILE start with COV_MAGIC?
+
+private:
+	const char * data;	//!< the mapped file
+	size_t length;		//!< bytes mapped
+	map<string, int> index;	//!< name -> table entry
+
+	coverage_cache(const coverage_cache &);
+	coverage_cache & operator=(const coverage_cache &);
+};
+
+bool write_coverage_cache(vector<string>, string);	// bedgraph FILES, output path
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file em_arrays.cpp
+ * @author Robin Dowell
+ * @brief The E-step of classifier::fit2 on structure-of-arrays tiles.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "em_arrays.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "emg_batch.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: em_arrays class (no components)
+ */
+em_arrays::em_arrays(){
+	K 	= 0;
+	noise_f = 0, noise_r = 0, noise_rf = 0, noise_rr = 0;
+}
+
+/**
+ * @brief Room for k EMG components (and their 2k uniform parts).
+ * @param k number of EMGs
+ */
+void em_arrays::resize(int k){
+	K 	= k;
+	vector<double> * E[] 	= {&mu, &si, &l, &w, &pi, &foot_print, &r_f, &r_r, &ey, &ex, &ex2, &C};
+	for (int e = 0; e < 12; e++){
+		E[e]->resize(K);
+	}
+	lo.resize(K), hi.resize(K);
+	u_f.resize(2*K), u_r.resize(2*K), u_rf.resize(2*K), u_rr.resize(2*K);
+	u_lo.resize(2*K), u_hi.resize(2*K);
+}
+
+/**
+ * @brief component::add_stats of one EMG on one strand over n bins,
+ * summed with vector accumulators.
+ * @param x bin coordinates
+ * @param inv y / density of each bin (0 where there is no data)
+ * @param p, EY, EY2 the EMG's density and expectations at the bins
+ * @param st strand, 1 or -1
+ * @param mu, fp the EMG's center and foot print
+ * @param S r, ey, ex, ex2, C (added to)
+ */
+static void emg_stats(const double * x, const double * inv, const double * p,
+		const double * EY, const double * EY2, int n, int st, double mu, double fp, double S[5]){
+	double r = 0, ey = 0, ex = 0, ex2 = 0, C = 0;
+	#pragma omp simd reduction(+:r,ey,ex,ex2,C)
+	for (int i = 0; i < n; i++){
+		double vl 	= p[i]*inv[i];	// responsibility times y
+		double v 	= vl > 0 ? vl : 0;
+		double e 	= vl > 0 ? EY[i] : 0, e2 = vl > 0 ? EY2[i] : 0;
+		double X 	= x[i] - st*e - fp*st;
+		r 	+= vl;
+		C 	+= max(st*(x[i]-mu) - e, 0.0)*v;
+		ey 	+= e*v;
+		ex 	+= X*v;
+		ex2 += (X*X + e2 - e*e)*v;
+	}
+	S[0]+=r, S[1]+=ey, S[2]+=ex, S[3]+=ex2, S[4]+=C;
+}
+
+/**
+ * @brief Start an E-step over XN bins: split the bins into pieces where
+ * no uniform part starts or ends and give each piece its density.
+ * @param XN bins
+ */
+void em_arrays::begin(int XN){
+	cuts.clear();
+	cuts.push_back(0), cuts.push_back(XN);
+	for (int u = 0; u < 2*K; u++){
+		if (u_lo[u] < u_hi[u]){
+			cuts.push_back(u_lo[u]), cuts.push_back(u_hi[u]);
+		}
+	}
+	sort(cuts.begin(), cuts.end());
+	cuts.erase(unique(cuts.begin(), cuts.end()), cuts.end());
+	int pieces 	= cuts.size() - 1;
+	piece_f.assign(pieces, 0), piece_r.assign(pieces, 0);
+	sum_f.assign(pieces, 0), sum_r.assign(pieces, 0);
+	for (int c = 0; c < pieces; c++){
+		for (int u = 0; u < 2*K; u++){
+			if (u_lo[u] <= cuts[c] and cuts[c+1] <= u_hi[u]){
+				piece_f[c]+=u_f[u], piece_r[c]+=u_r[u];
+			}
+		}
+		piece_f[c]+=noise_f, piece_r[c]+=noise_r;
+	}
+	piece 	= 0;
+	stats.assign(5*2*K, 0.0);
+	ll 		= 0;
+}
+
+/**
+ * @brief The E-step over bins t0 ... t0+n-1 (n at most EM_TILE); tiles
+ * come in order.
+ * @param x bin coordinates
+ * @param f forward coverage
+ * @param r reverse coverage
+ * @param t0 first bin
+ * @param n bins
+ */
+void em_arrays::tile(const double * x, const double * f, const double * r, int t0, int n){
+	double dens_f[EM_TILE], dens_r[EM_TILE], inv_f[EM_TILE], inv_r[EM_TILE];
+	//uniform parts and noise, piece by piece
+	while (cuts[piece+1] <= t0){
+		piece++;
+	}
+	for (int i = 0, c = piece; i < n; c++){
+		int e 	= min(n, cuts[c+1] - t0);
+		for (; i < e; i++){
+			dens_f[i] 	= piece_f[c], dens_r[i] = piece_r[c];
+		}
+	}
+	//the EMGs reaching this tile: their rows of the responsibility matrix
+	slot.clear();
+	for (int k = 0; k < K; k++){
+		if (lo[k] < t0 + n and hi[k] > t0 and lo[k] < hi[k]){
+			slot.push_back(k);
+		}
+	}
+	if (tile_m.size() < slot.size()*6*EM_TILE){
+		tile_m.resize(slot.size()*6*EM_TILE);
+	}
+	for (size_t j = 0; j < slot.size(); j++){
+		int k 	= slot[j];
+		int a = max(lo[k], t0), b = min(hi[k], t0 + n);
+		emg_params P;
+		P.mu = mu[k], P.si = si[k], P.l = l[k], P.w = w[k], P.pi = pi[k];
+		P.foot_print 	= foot_print[k];
+		double * T 	= &tile_m[j*6*EM_TILE];
+		emg_batch(P, x + a, b - a, 1, T, T + EM_TILE, T + 2*EM_TILE);
+		emg_batch(P, x + a, b - a, -1, T + 3*EM_TILE, T + 4*EM_TILE, T + 5*EM_TILE);
+		double * Df = dens_f + a - t0, * Dr = dens_r + a - t0;
+		#pragma omp simd
+		for (int i = 0; i < b - a; i++){
+			Df[i]+=T[i], Dr[i]+=T[3*EM_TILE + i];
+		}
+	}
+	//y / density, and the log likelihood
+	int c 	= piece;
+	for (int i = 0; i < n; i++){
+		int b 	= t0 + i;
+		inv_f[i] = 0, inv_r[i] = 0;
+		if (f[b] and dens_f[i] > 0){
+			inv_f[i] 	= f[b] / dens_f[i];
+			ll+=log(dens_f[i])*f[b];
+		}
+		if (r[b] and dens_r[i] > 0){
+			inv_r[i] 	= r[b] / dens_r[i];
+			ll+=log(dens_r[i])*r[b];
+		}
+		while (cuts[c+1] <= b){
+			c++;
+		}
+		sum_f[c]+=inv_f[i], sum_r[c]+=inv_r[i];
+	}
+	//the EMGs' statistics over the tile
+	for (size_t j = 0; j < slot.size(); j++){
+		int k 	= slot[j];
+		int a = max(lo[k], t0), b = min(hi[k], t0 + n);
+		const double * T 	= &tile_m[j*6*EM_TILE];
+		emg_stats(x + a, inv_f + a - t0, T, T + EM_TILE, T + 2*EM_TILE, b - a,
+			1, mu[k], foot_print[k], &stats[10*k]);
+		emg_stats(x + a, inv_r + a - t0, T + 3*EM_TILE, T + 4*EM_TILE, T + 5*EM_TILE, b - a,
+			-1, mu[k], foot_print[k], &stats[10*k + 5]);
+	}
+}
+
+/**
+ * @brief Finish an E-step: every component's sufficient statistics
+ * (r_f ... noise_rr, overwritten).
+ * @return log likelihood
+ */
+double em_arrays::end(){
+	for (int k = 0; k < K; k++){
+		const double * S 	= &stats[10*k];
+		r_f[k] 	= S[0], r_r[k] = S[5];
+		ey[k] 	= S[1] + S[6], ex[k] = S[2] + S[7];
+		ex2[k] 	= S[3] + S[8], C[k] = S[4] + S[9];
+	}
+	int pieces 	= cuts.size() - 1;
+	double all_f = 0, all_r = 0;
+	for (int c = 0; c < pieces; c++){
+		all_f+=sum_f[c], all_r+=sum_r[c];
+	}
+	for (int u = 0; u < 2*K; u++){
+		double in_f = 0, in_r = 0;
+		for (int c = 0; c < pieces and u_lo[u] < u_hi[u]; c++){
+			if (u_lo[u] <= cuts[c] and cuts[c+1] <= u_hi[u]){
+				in_f+=sum_f[c], in_r+=sum_r[c];
+			}
+		}
+		u_rf[u] 	= u_f[u]*in_f;
+		u_rr[u] 	= u_r[u]*in_r;
+	}
+	noise_rf 	= noise_f*all_f;
+	noise_rr 	= noise_r*all_r;
+	return ll;
+}
+
+/**
+ * @brief One E-step: the log likelihood of the bins and every
+ * component's sufficient statistics (r_f ... noise_rr, overwritten).
+ * @param x bin coordinates
+ * @param f forward coverage
+ * @param r reverse coverage
+ * @param XN bins
+ * @return log likelihood
+ */
+double em_arrays::estep(const double * x, const double * f, const double * r, int XN){
+	begin(XN);
+	for (int t0 = 0; t0 < XN; t0+=EM_TILE){
+		tile(x, f, r, t0, min(EM_TILE, XN - t0));
+	}
+	return end();
+}
+
+/**
+ * @brief The E-steps of several fits to the same bins in one pass: each
+ * tile of coverage is read once and used by every fit while it is in
+ * cache.  The same as estep() on each.
+ * @param E the fits
+ * @param x bin coordinates
+ * @param f forward coverage
+ * @param r reverse coverage
+ * @param XN bins
+ * @param ll log likelihood of each fit (out)
+ */
+void estep_all(vector<em_arrays *> & E, const double * x, const double * f, const double * r, int XN,
+		vector<double> & ll){
+	for (size_t e = 0; e < E.size(); e++){
+		E[e]->begin(XN);
+	}
+	for (int t0 = 0; t0 < XN; t0+=EM_TILE){
+		for (size_t e = 0; e < E.size(); e++){
+			E[e]->tile(x, f, r, t0, min(EM_TILE, XN - t0));
+		}
+	}
+	ll.resize(E.size());
+	for (size_t e = 0; e < E.size(); e++){
+		ll[e] 	= E[e]->end();
+	}
+}
@@ -0,0 +1,74 @@
+/**
+ * @file em_arrays.h
+ * @author Robin Dowell
+ * @brief The E-step of classifier::fit2 on structure-of-arrays tiles
+ * (-em_tiles 1).  The parameters of all components of a fit sit in
+ * contiguous arrays.  The bins are walked EM_TILE at a time: every EMG
+ * that reaches a tile is evaluated there by the batch kernel
+ * (emg_batch.h) into a tile of the responsibility matrix, and the
+ * sufficient statistics of component::add_stats are reduced from it
+ * with vector (omp simd) accumulators.  The uniform parts and the noise
+ * are constant between the bins where one of them starts or ends, so
+ * their share of each bin's density is worked out once per E-step for
+ * each such piece, and their statistics come from sums of y / density
+ * over the pieces.  estep_all() runs the E-steps of several fits (the
+ * -rounds restarts) in one pass over the bins, a tile at a time.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef em_arrays_H
+#define em_arrays_H
+
+#include <vector>
+
+using namespace std;
+
+#define EM_TILE 512	//!< bins per tile of the responsibility matrix
+
+/**
+ * @brief One fit's components as arrays, and what an E-step sums up.
+ * EMG k is component k's bidir; uniform part 2k is its forward
+ * elongation and 2k+1 its reverse one.
+ */
+class em_arrays{
+public:
+	int K;	//!< EMG components
+	//EMG parameters (see EMG in model.h) and the bins [lo, hi) each reaches
+	vector<double> mu, si, l, w, pi, foot_print;
+	vector<int> lo, hi;
+	//uniform parts: density on each strand, constant over bins [u_lo, u_hi)
+	vector<double> u_f, u_r;
+	vector<int> u_lo, u_hi;
+	double noise_f, noise_r;	//!< noise density on each strand (0 if none)
+
+	//sufficient statistics from estep()
+	vector<double> r_f, r_r, ey, ex, ex2, C;	//!< per EMG
+	vector<double> u_rf, u_rr;	//!< per uniform part
+	double noise_rf, noise_rr;
+
+	// Constructors
+	em_arrays();
+
+	/* FUNCTIONS: */
+	void resize(int);	// K; parameters are then filled in by the caller
+	double estep(const double *, const double *, const double *, int);	// x, forward, reverse, bins -> log likelihood
+	// estep() in parts, so that several fits can share each pass over a tile
+	void begin(int);	// bins
+	void tile(const double *, const double *, const double *, int, int);	// x, forward, reverse, first bin, bins
+	double end();
+
+private:
+	vector<int> cuts;	//!< bins where a uniform part starts or ends (with 0 and XN)
+	vector<double> piece_f, piece_r;	//!< uniform + noise density between cuts
+	vector<double> sum_f, sum_r;	//!< y / density summed between cuts
+	int piece;			//!< piece of the next tile's first bin
+	vector<double> stats;	//!< r, ey, ex, ex2, C per EMG and strand
+	double ll;
+	vector<double> tile_m;	//!< p, EY, EY2 on both strands per EMG reaching the tile
+	vector<int> slot;		//!< those EMGs
+};
+
+void estep_all(vector<em_arrays *> &, const double *, const double *, const double *, int, vector<double> &);	// one pass for all fits -> their log likelihoods
+
+#endif
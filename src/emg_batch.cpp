@@ -0,0 +1,49 @@
+/**
+ * @file emg_batch.cpp
+ * @author Robin Dowell
+ * @brief Batch EMG evaluation: the baseline kernel and the runtime dispatch.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#define EMG_BATCH_KERNEL emg_batch_scalar
+#include "emg_batch_impl.h"
+
+typedef void (*emg_batch_kernel)(const emg_params &, const double *, int, int, double *, double *, double *);
+
+/**
+ * @brief The widest kernel this CPU runs.
+ */
+static emg_batch_kernel pick_kernel(const char *& isa){
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")){
+		isa 	= "avx512";
+		return emg_batch_avx512;
+	}
+	if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma")){
+		isa 	= "avx2";
+		return emg_batch_avx2;
+	}
+	isa 	= "scalar";
+	return emg_batch_scalar;
+}
+
+static const char * kernel_isa;
+static const emg_batch_kernel kernel 	= pick_kernel(kernel_isa);
+
+/**
+ * @brief EMG::pdf (and EMG::EY, EMG::EY2) of one component at n bins.
+ * @param E the component
+ * @param x bin coordinates
+ * @param n number of bins
+ * @param s strand, 1 or -1
+ * @param p densities (out)
+ * @param ey, ey2 conditional expectations of Y and Y^2 (out, NULL to skip both)
+ */
+void emg_batch(const emg_params & E, const double * x, int n, int s, double * p, double * ey, double * ey2){
+	kernel(E, x, n, s, p, ey, ey2);
+}
+
+const char * emg_batch_isa(){
+	return kernel_isa;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file emg_batch.h
+ * @author Robin Dowell
+ * @brief Batch evaluation of the EMG density (EMG::pdf) and conditional
+ * expectations (EMG::EY, EMG::EY2) over an array of bin coordinates.
+ * The kernel (emg_batch_impl.h) is branch free and built three times:
+ * for AVX-512, for AVX2/FMA and for the baseline instruction set.  The
+ * widest one the CPU supports is picked once, during static initialization
+ * (emg_batch.cpp).  exp and erfc are evaluated inline (Cody-Waite reduced
+ * polynomial, Cody's rational erfc), to within a few ulp of libm; exp
+ * underflows to 0 below -708.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef emg_batch_H
+#define emg_batch_H
+
+/**
+ * @brief The parameters of one EMG component (see EMG in model.h).
+ */
+class emg_params{
+public:
+	double mu, si, l, w, pi;	//!< center, sigma, lambda, weight, strand bias
+	double foot_print;			//!< shift of each strand's mode away from mu
+};
+
+// x[0..n) on strand s (1/-1) -> p = EMG::pdf; ey = EMG::EY, ey2 = EMG::EY2 (skipped if NULL)
+void emg_batch(const emg_params &, const double *, int, int, double *, double *, double *);
+const char * emg_batch_isa();	// "avx512", "avx2" or "scalar": the kernel emg_batch() runs
+
+// the kernels themselves (emg_batch() dispatches to one of these)
+void emg_batch_scalar(const emg_params &, const double *, int, int, double *, double *, double *);
+void emg_batch_avx2(const emg_params &, const double *, int, int, double *, double *, double *);
+void emg_batch_avx512(const emg_params &, const double *, int, int, double *, double *, double *);
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * @file emg_batch_avx2.cpp
+ * @author Robin Dowell
+ * @brief Batch EMG evaluation, built for AVX2 and FMA (-mavx2 -mfma).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#define EMG_BATCH_KERNEL emg_batch_avx2
+#include "emg_batch_impl.h"
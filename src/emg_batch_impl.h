@@ -0,0 +1,145 @@
+/**
+ * @file emg_batch_impl.h
+ * @author Robin Dowell
+ * @brief The emg_batch kernel.  Included once by each of emg_batch.cpp,
+ * emg_batch_avx2.cpp and emg_batch_avx512.cpp, which define EMG_BATCH_KERNEL
+ * to the name of the function to emit and are compiled for their
+ * instruction set.  Everything is branch free so the loops vectorize.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "emg_batch.h"
+
+namespace {
+
+const double LOG2E 	= 1.44269504088896338700e+00;
+const double LN2_HI = 6.93147180369123816490e-01;	// k*LN2_HI is exact
+const double LN2_LO = 1.90821492927058770002e-10;
+const double ROUND 	= 6755399441055744.0;	// 2^52 + 2^51: x + ROUND rounds x to an integer
+
+/**
+ * @brief exp(x): x = k*ln2 + r, |r| <= ln2/2, exp(r) by its Taylor series
+ * (degree 13), times 2^k built from the exponent bits.  0 below -708.
+ */
+inline double batch_exp(double x){
+	double xc 	= x < -708.0 ? -708.0 : (x > 709.79 ? 709.79 : x);
+	double kr 	= xc*LOG2E + ROUND;	// low mantissa bits hold k
+	double k 	= kr - ROUND;
+	double r 	= (xc - k*LN2_HI) - k*LN2_LO;
+	double p 	= 1.0/6227020800.0;
+	p 	= p*r + 1.0/479001600.0;
+	p 	= p*r + 1.0/39916800.0;
+	p 	= p*r + 1.0/3628800.0;
+	p 	= p*r + 1.0/362880.0;
+	p 	= p*r + 1.0/40320.0;
+	p 	= p*r + 1.0/5040.0;
+	p 	= p*r + 1.0/720.0;
+	p 	= p*r + 1.0/120.0;
+	p 	= p*r + 1.0/24.0;
+	p 	= p*r + 1.0/6.0;
+	p 	= p*r + 0.5;
+	p 	= p*r + 1.0;
+	p 	= p*r + 1.0;
+	uint64_t bits;
+	memcpy(&bits, &kr, sizeof(bits));
+	bits 	= (bits + 1022) << 52;	// 2^(k-1): k runs up to 1024
+	double scale;
+	memcpy(&scale, &bits, sizeof(scale));
+	double e 	= p*scale*2.0;	// inf above 709.78, nan for nan
+	return x < -708.0 ? 0.0 : e;
+}
+
+/**
+ * @brief erfc(x), W. J. Cody's rational approximations (CALERF) on
+ * |x| <= 0.46875, 0.46875 < |x| <= 4 and |x| > 4, all three evaluated
+ * and the right one selected.
+ */
+inline double batch_erfc(double x){
+	double y 	= x < 0 ? -x : x;
+	// |x| <= 0.46875: 1 - erf(x)
+	double ysq 	= y*y;
+	double an 	= 1.85777706184603153e-1*ysq, ad = ysq;
+	an 	= (an + 3.16112374387056560e00)*ysq, ad = (ad + 2.36012909523441209e01)*ysq;
+	an 	= (an + 1.13864154151050156e02)*ysq, ad = (ad + 2.44024637934444173e02)*ysq;
+	an 	= (an + 3.77485237685302021e02)*ysq, ad = (ad + 1.28261652607737228e03)*ysq;
+	double small 	= 1.0 - x*(an + 3.20937758913846947e03)/(ad + 2.84423683343917062e03);
+	// 0.46875 < |x| <= 4
+	double cn 	= 2.15311535474403846e-8*y, cd = y;
+	cn 	= (cn + 5.64188496988670089e-1)*y, cd = (cd + 1.57449261107098347e01)*y;
+	cn 	= (cn + 8.88314979438837594e00)*y, cd = (cd + 1.17693950891312499e02)*y;
+	cn 	= (cn + 6.61191906371416295e01)*y, cd = (cd + 5.37181101862009858e02)*y;
+	cn 	= (cn + 2.98635138197400131e02)*y, cd = (cd + 1.62138957456669019e03)*y;
+	cn 	= (cn + 8.81952221241769090e02)*y, cd = (cd + 3.29079923573345963e03)*y;
+	cn 	= (cn + 1.71204761263407058e03)*y, cd = (cd + 4.36261909014324716e03)*y;
+	cn 	= (cn + 2.05107837782607147e03)*y, cd = (cd + 3.43936767414372164e03)*y;
+	double mid 	= (cn + 1.23033935479799725e03)/(cd + 1.23033935480374942e03);
+	// |x| > 4
+	double iy 	= 1.0/(y*y);
+	double pn 	= 1.63153871373020978e-2*iy, pd = iy;
+	pn 	= (pn + 3.05326634961232344e-1)*iy, pd = (pd + 2.56852019228982242e00)*iy;
+	pn 	= (pn + 3.60344899949804439e-1)*iy, pd = (pd + 1.87295284992346725e00)*iy;
+	pn 	= (pn + 1.25781726111229246e-1)*iy, pd = (pd + 5.27905102951428412e-1)*iy;
+	pn 	= (pn + 1.60837851487422766e-2)*iy, pd = (pd + 6.05183413124413191e-2)*iy;
+	double large 	= (5.6418958354775628695e-1 - iy*(pn + 6.58749161529837803e-4)/(pd + 2.33520497626869185e-3))/y;
+	// exp(-y^2) in two parts to keep its precision
+	double yc 	= y < 27.0 ? y : 27.0;
+	double yt 	= double(int(yc*16.0))/16.0;
+	double tail = (y <= 4.0 ? mid : large)*batch_exp(-yt*yt)*batch_exp(-(yc - yt)*(yc + yt));
+	tail 	= y < 26.543 ? tail : 0.0;
+	tail 	= x < 0 ? 2.0 - tail : tail;
+	return y <= 0.46875 ? small : tail;
+}
+
+/**
+ * @brief Mills ratio R(x) of model.cpp: (1 - Phi(x)) / phi(x), 1/x above 4
+ * and 1e15 where phi(x) < 1e-15.
+ */
+inline double batch_mills(double x){
+	double D 	= batch_exp(-0.5*x*x)*0.3989422804014326779;	// 1/sqrt(2 pi)
+	double m 	= 0.5*batch_erfc(x*0.7071067811865475244)/D;
+	m 	= D < 1e-15 ? 1e15 : m;
+	return x > 4 ? 1.0/x : m;
+}
+
+}
+
+/**
+ * @brief EMG::pdf, and EMG::EY / EMG::EY2 if asked for, of one component
+ * at each of x[0] ... x[n-1] on strand s.
+ */
+void EMG_BATCH_KERNEL(const emg_params & E, const double * x, int n, int s,
+		double * p, double * ey, double * ey2){
+	const double mu = E.mu, si = E.si, l = E.l;
+	const double shift 	= s*E.foot_print;	// z -= fp on the forward strand, += on the reverse
+	const double lsi2 	= l*si*si;
+	const double mass 	= E.w*(s==1 ? E.pi : 1 - E.pi);
+	const double c 		= 1.0/(1.4142135623730950488*si);
+	if (E.w == 0){
+		for (int i = 0; i < n; i++){
+			p[i] 	= 0;
+		}
+	}else{
+		#pragma omp simd
+		for (int i = 0; i < n; i++){
+			double d 	= mu - (x[i] - shift);
+			double v 	= (l/2)*batch_exp((l/2)*(2*s*d + lsi2))*batch_erfc((s*d + lsi2)*c)*mass;
+			p[i] 		= v < 1e7 ? v : 0.0;	// also drops nan
+		}
+	}
+	if (ey == NULL or ey2 == NULL){
+		return;
+	}
+	const double l2si4 	= lsi2*lsi2;
+	#pragma omp simd
+	for (int i = 0; i < n; i++){
+		double d 	= mu - (x[i] - shift);
+		double R 	= batch_mills(l*si + s*d/si);
+		double a 	= -s*d - lsi2 + si/R;
+		ey[i] 		= a > 0 ? a : 0.0;
+		ey2[i] 		= l2si4 + si*si*(2*l*s*d + 1) + d*d - si*(lsi2 + s*d)/R;
+	}
+}
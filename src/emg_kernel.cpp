@@ -0,0 +1,56 @@
+/**
+ * @file emg_kernel.cpp
+ * @author Robin Dowell
+ * @brief EMG template densities tabulated on the bin lattice.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "emg_kernel.h"
+
+#include <mutex>
+
+#include "model.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: tabulate both strands.
+ * @param step lattice spacing (-br/-ns)
+ * @param sigma, lambda, fp template, scaled as for EMG
+ * @param D largest offset needed
+ */
+emg_kernel::emg_kernel(double step, double sigma, double lambda, double fp, int D){
+	this->step 	= step, this->sigma = sigma, this->lambda = lambda;
+	this->foot_print 	= fp, this->D = D;
+	for (int s = 0; s < 2; s++){
+		EMG E(0, sigma, lambda, 1.0, s==0 ? 1.0 : 0.0);
+		E.foot_print 	= fp;
+		p[s].resize(2*D+1);
+		for (int d = -D; d <= D; d++){
+			p[s][d+D] 	= E.pdf(d*step, s==0 ? 1 : -1);
+		}
+	}
+}
+
+/**
+ * @brief The shared table for a parameter set, built on first use.
+ * Tables are never freed, so the reference stays valid for the whole run.
+ * @param step lattice spacing (-br/-ns)
+ * @param sigma, lambda, fp template, scaled as for EMG
+ * @param D largest offset needed (a table covering more may be returned)
+ */
+const emg_kernel & emg_kernel::get(double step, double sigma, double lambda, double fp, int D){
+	static mutex guard;
+	static vector<emg_kernel *> built;
+	lock_guard<mutex> lock(guard);
+	for (int t = 0; t < built.size(); t++){
+		const emg_kernel * K 	= built[t];
+		if (K->step == step and K->sigma == sigma and K->lambda == lambda
+			and K->foot_print == fp and K->D >= D){
+			return *K;
+		}
+	}
+	built.push_back(new emg_kernel(step, sigma, lambda, fp, D));
+	return *built.back();
+}
@@ -0,0 +1,57 @@
+/**
+ * @file emg_kernel.h
+ * @author Robin Dowell
+ * @brief EMG template densities tabulated on the bin lattice.
+ * Template matching and get_slice() evaluate EMG::pdf with one sigma,
+ * lambda and foot_print, and always at bin offsets that are whole multiples
+ * of -br/-ns.  emg_kernel tabulates the density of each strand once per
+ * parameter set; get() hands out a process wide, read only copy that any
+ * number of OpenMP threads may use at once.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef emg_kernel_H
+#define emg_kernel_H
+
+#include <math.h>
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief EMG::pdf(mu + d*step, s) for mu = 0, w = 1 and all mass on
+ * strand s, for offsets d = -D ... D.
+ */
+class emg_kernel{
+public:
+	double step;		//!< lattice spacing of scaled bin coordinates (-br/-ns)
+	double sigma, lambda, foot_print;	//!< scaled as for EMG
+	int D;				//!< largest tabulated offset (lattice steps)
+	vector<double> p[2];	//!< density at offset d + D, forward [0] and reverse [1]
+
+	/* FUNCTIONS: */
+	static const emg_kernel & get(double, double, double, double, int);	// step, sigma, lambda, fp, D
+
+	/**
+	 * @brief Lattice offset of a coordinate difference.
+	 * @param dx x - mu in scaled coordinates
+	 * @param d set to the offset in lattice steps
+	 * @return false if dx is off the lattice or beyond the table
+	 */
+	bool offset(double dx, int & d) const {
+		double q 	= dx/step;
+		if (fabs(q) > D + 1){
+			return false;
+		}
+		d 			= int(lround(q));
+		return fabs(q - d) <= 1e-6 and d >= -D and d <= D;
+	}
+	double pdf(int d, int s) const { return p[s==1 ? 0 : 1][d + D]; }	// offset, strand (1/-1)
+
+private:
+	emg_kernel(double, double, double, double, int);
+};
+
+#endif
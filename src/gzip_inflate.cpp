@@ -0,0 +1,194 @@
+/**
+ * @file gzip_inflate.cpp
+ * @author Robin Dowell
+ * @brief Decompression of gzip and BGZF compressed input (e.g. bedgraph.gz).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gzip_inflate.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <omp.h>
+#include <zlib.h>
+
+using namespace std;
+
+static uint16_t get16(const unsigned char * p){ return p[0] | (p[1] << 8); }
+static uint32_t get32(const unsigned char * p){ return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+
+/**
+ * @brief A gzip member starts 1f 8b and deflate (8).
+ */
+bool is_gzip(const char * data, size_t n){
+	const unsigned char * p 	= (const unsigned char *)data;
+	return n >= 18 and p[0]==0x1f and p[1]==0x8b and p[2]==8;
+}
+
+/**
+ * @brief Size of the BGZF block starting at p (its BSIZE + 1), 0 if p does
+ * not start a BGZF block: a gzip member with an extra field holding the
+ * "BC" subfield.
+ * @param p start of a member
+ * @param n bytes available from p
+ * @param xlen set to the length of the extra field
+ */
+static size_t bgzf_block(const unsigned char * p, size_t n, size_t & xlen){
+	if (not is_gzip((const char *)p, n) or not (p[3] & 4)){
+		return 0;
+	}
+	xlen 	= get16(p + 10);
+	if (12 + xlen > n){
+		return 0;
+	}
+	for (size_t x = 12; x + 4 <= 12 + xlen; x += 4 + get16(p + x + 2)){
+		if (p[x]=='B' and p[x+1]=='C' and get16(p + x + 2)==2 and x + 6 <= 12 + xlen){
+			size_t bsize 	= size_t(get16(p + x + 4)) + 1;
+			return (bsize >= 12 + xlen + 8 and bsize <= n) ? bsize : 0;
+		}
+	}
+	return 0;
+}
+
+bool is_bgzf(const char * data, size_t n){
+	size_t xlen;
+	return bgzf_block((const unsigned char *)data, n, xlen) > 0;
+}
+
+/**
+ * @brief Inflate BGZF input: find every block from its header, size the
+ * output from the blocks' ISIZE fields, then inflate all blocks at once,
+ * each straight into its place in the output.
+ * @return false if the input is not entirely BGZF blocks or a block is corrupt
+ */
+static bool bgzf_inflate(const char * data, size_t n, char *& out, size_t & out_n){
+	const unsigned char * src 	= (const unsigned char *)data;
+	vector<size_t> at, len, to;	// block payload offset, payload size, output offset
+	size_t pos = 0, total = 0;
+	while (pos < n){
+		size_t xlen;
+		size_t bsize 	= bgzf_block(src + pos, n - pos, xlen);
+		if (bsize == 0){
+			return false;
+		}
+		at.push_back(pos + 12 + xlen);
+		len.push_back(bsize - 12 - xlen - 8);
+		to.push_back(total);
+		total 	+= get32(src + pos + bsize - 4);
+		pos 	+= bsize;
+	}
+	out 	= (char *)malloc(total + 1);
+	if (out == NULL){
+		return false;
+	}
+	bool ok 	= true;
+	int num_proc 	= omp_get_max_threads();
+	#pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+	for (size_t b = 0; b < at.size(); b++){
+		size_t size 	= ((b+1 < at.size()) ? to[b+1] : total) - to[b];
+		const unsigned char * trailer 	= src + at[b] + len[b];
+		z_stream z;
+		memset(&z, 0, sizeof(z));
+		bool good 	= inflateInit2(&z, -15) == Z_OK;
+		if (good){
+			z.next_in 	= (Bytef *)(src + at[b]);
+			z.avail_in 	= len[b];
+			z.next_out 	= (Bytef *)(out + to[b]);
+			z.avail_out = size;
+			good 	= inflate(&z, Z_FINISH) == Z_STREAM_END and z.total_out == size;
+			inflateEnd(&z);
+		}
+		good 	= good and crc32(0, (const Bytef *)(out + to[b]), size) == get32(trailer);
+		if (not good){
+			#pragma omp atomic write
+			ok 	= false;
+		}
+	}
+	if (not ok){
+		free(out);
+		out 	= NULL;
+		return false;
+	}
+	out_n 	= total;
+	return true;
+}
+
+/**
+ * @brief Inflate gzip or BGZF input held in memory (e.g. a mapped file).
+ * BGZF blocks are inflated in parallel; plain gzip is inflated front to
+ * back (it can't be split) into a buffer that grows as needed.  Either way
+ * the whole inflated text is held in memory, as the loaders scan and re-read
+ * it in parallel chunks.
+ * @param data compressed input
+ * @param n its size
+ * @param out set to a malloc'd buffer holding the inflated bytes (caller frees)
+ * @param out_n set to the number of inflated bytes
+ * @return false (with a message) if the input is corrupt
+ */
+bool gzip_inflate(const char * data, size_t n, char *& out, size_t & out_n){
+	out 	= NULL, out_n = 0;
+	if (is_bgzf(data, n) and bgzf_inflate(data, n, out, out_n)){
+		return true;
+	}
+	const size_t most 	= size_t(1) << 30;	// zlib counts bytes in 32 bits
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	bool ok 	= inflateInit2(&z, 15 + 16) == Z_OK;
+	bool room 	= true;
+	size_t cap = 0, in = 0;	// output allocated, input handed to zlib
+	while (ok){
+		if (z.avail_in == 0 and in < n){
+			z.next_in 	= (Bytef *)(data + in);
+			z.avail_in 	= min(n - in, most);
+			in 	+= z.avail_in;
+		}
+		if (out_n == cap){
+			size_t grow 	= max(cap*2, n*4);
+			char * grown 	= (char *)realloc(out, grow);
+			room 	= grown != NULL;
+			if (not room){
+				break;
+			}
+			out = grown, cap = grow;
+		}
+		z.next_out 	= (Bytef *)(out + out_n);
+		z.avail_out = min(cap - out_n, most);
+		size_t given 	= z.avail_out;
+		int r 		= inflate(&z, Z_NO_FLUSH);
+		out_n 		+= given - z.avail_out;
+		if (r == Z_STREAM_END){
+			// another member follows (concatenated gzip files, BGZF);
+			// anything else left over is ignored, as gzip does
+			const unsigned char * rest 	= z.next_in;
+			size_t left 	= z.avail_in + (n - in);
+			if (left < 2 or rest[0] != 0x1f or rest[1] != 0x8b){
+				break;
+			}
+			ok 	= is_gzip((const char *)rest, left);	// else a truncated header
+			inflateReset(&z);
+		}else if (r != Z_OK and r != Z_BUF_ERROR){
+			ok 	= false;
+		}else if (r == Z_BUF_ERROR and z.avail_in == 0 and in == n and z.avail_out > 0){
+			ok 	= false;	// truncated
+		}
+	}
+	inflateEnd(&z);
+	if (not room){
+		printf("out of memory inflating gzip input\n");
+	}else if (not ok){
+		printf("corrupt or truncated gzip input\n");
+	}
+	if (not ok or not room){
+		free(out);
+		out = NULL, out_n = 0;
+		return false;
+	}
+	return true;
+}
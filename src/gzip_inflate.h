@@ -0,0 +1,23 @@
+/**
+ * @file gzip_inflate.h
+ * @author Robin Dowell
+ * @brief Decompression of gzip and BGZF compressed input (e.g. bedgraph.gz).
+ * BGZF files (bgzip, htslib) are a series of independent gzip members whose
+ * sizes are in their headers, so all of them are inflated in parallel.
+ * Plain gzip can only be inflated front to back.  The inflated text is
+ * held in memory in full (its uncompressed size), as the loaders read it
+ * in parallel chunks and more than once.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef gzip_inflate_H
+#define gzip_inflate_H
+
+#include <stddef.h>
+
+bool is_gzip(const char *, size_t);	// starts with the gzip magic bytes?
+bool is_bgzf(const char *, size_t);	// starts with a BGZF block header?
+bool gzip_inflate(const char *, size_t, char *&, size_t &);	// input, size -> malloc'd output, size
+
+#endif
@@ -13,6 +13,7 @@
 
 #include <math.h>   
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -24,12 +25,18 @@
 #include <limits>
 #include <map>
 #include <random>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <omp.h>
+
 #include "dirent.h"
 
 #include "across_segments.h"
+#include "bedgraph_reader.h"
+#include "bigwig_reader.h"
+#include "coverage_cache.h"
 #include "model.h"
 #include "model_selection.h"
 #include "read_in_parameters.h"
@@ -130,6 +137,37 @@ string segment::write_out(){
 	return text;
 }
 
+/**
+ * @brief Constructor: coverage_run class
+ * @param st  first base
+ * @param sp  one past the last base
+ * @param y   value (read depth assumed)
+ */
+coverage_run::coverage_run(double st, double sp, double y){
+  start = st, stop = sp, value = y;
+}
+
+/**
+ * @brief Constructor: chrom_extent class (no lines yet)
+ * @param chr chromosome name
+ * @param l first base
+ * @param h last base
+ */
+chrom_extent::chrom_extent(string chr, double l, double h){
+  chrom = chr, lo = l, hi = h;
+}
+
+/**
+ * @brief Rough memory footprint of the chromosome once loaded and scanned:
+ * per bin X (3 doubles), the streamed coverage (2) and the template
+ * matching scores (3).
+ * @param delta bin width (nts)
+ * @return bytes
+ */
+double chrom_extent::bytes(double delta) const {
+  return ((hi - lo)/delta + 1) * 8 * sizeof(double);
+}
+
 /**
  * @brief Given a dta point, build segment contents.
  * @author Joey Azofeifa
@@ -139,31 +177,40 @@ string segment::write_out(){
  * @return (void)
  */
 void segment::add2(int strand, double x, double y){
-  vector<double> v2(2);
-  v2[0] 	= x;
-  v2[1] 	= y;
-  if (forward.empty() && reverse.empty()){
-    minX=x;
-    maxX=x;
+  add_run(strand, x, x+1, y);
+}
+
+/**
+ * @brief Given a bedgraph line, build segment contents.
+ * Equivalent to calling add2 for every base start, start+1, ... < stop; the
+ * bases are binned straight away into coverage (see coverage_bins).
+ * @param strand  here as integer, 1 == forward, -1 == reverse
+ * @param st  first base
+ * @param sp  one past the last base
+ * @param y   value (read depth assumed)
+ * @return (void)
+ */
+void segment::add_run(int strand, double st, double sp, double y){
+  if (sp <= st){
+    return;
+  }
+  double last 	= st + ceil(sp - st) - 1;	// last base actually covered
+  if (coverage.empty){
+    minX=st;
+    maxX=last;
   }else{
-    if (x < minX){
-      minX=x;
-      start=int(x);
+    if (st < minX){
+      minX=st;
+      start=int(st);
     }
-    if (x > maxX){
-      maxX=x;
-      stop=int(x);
+    if (last > maxX){
+      maxX=last;
+      stop=int(last);
     }
   }
-  // [ x y ] where x is the coordinate and y is the value (depth)
-  if (strand == 1){
-    forward.push_back(v2);
-  }else if (strand==-1){
-    reverse.push_back(v2);
-  }
+  coverage.add(strand, st, sp, y);
 }
 
-
 /**
  * @brief For a segment of data, scale and bin (smooth) input data into X vector
  * @author Joey Azofeifa
@@ -189,16 +236,13 @@ void segment::bin(double delta, double scale, bool erase){
   // X[0] is scaled coordinate
   // X[1] is sum of forward values over bin width (delta)
   // X[2] is sum of reverse values over bin width (delta)
-  X 				= new double*[3];
   SCALE 			= scale;
 
   int BINS;
   BINS 		= (maxX-minX)/delta;
   start = minX, stop=maxX;	// Why are we keeping these distinctly?
 
-  for (int j = 0 ; j < 3;j++){
-    X[j] 		= new double[BINS];
-  }
+  X.resize(3, max(BINS, 1));	// zeroed
   N 				= 0;
   fN = 0, rN = 0;
   XN 				= BINS;  // will adjust if erase
@@ -206,46 +250,43 @@ void segment::bin(double delta, double scale, bool erase){
   //===================
   //populate bin ranges
   X[0][0] 		= double(minX);
-  X[1][0]=0,X[2][0]=0;
 	
   for (int i = 1; i < BINS; i++){
     X[0][i] 	= X[0][i-1] + delta;
-    X[1][i] 	= 0;
-    X[2][i] 	= 0;
   }
 
   if (debug) {
 	  printf("start: %d , stop: %d , bins: %d ,delta: %f, forward: %d, reverse: %d\n", 
-			  start, stop, BINS, delta, forward.size(), reverse.size() );
+			  start, stop, BINS, delta, int(coverage.forward.size()), int(coverage.reverse.size()) );
   }
 
   // ===================
-  //BIN forward strand
-  int j 	=0;
-  for (int i = 0 ; i < forward.size(); i++){
-	  // RDD: To me this seems klunky.  Why do it this way?
-    while (j < BINS and X[0][j] <=forward[i][0]){
-      j++;
-    }
-    if (j < BINS and forward[i][0]<= X[0][j]){
-      X[1][j-1]+=forward[i][1];
-      N+=forward[i][1];
-      fN+=forward[i][1];
+  //Copy over the bins streamed in by the loader; the streamed lattice
+  //starts off bins before minX (0 unless it was anchored elsewhere)
+  double off 	= (minX - coverage.origin)/delta;
+  if (coverage.empty){
+    // nothing was read in for this segment
+  }else if (coverage.misaligned or coverage.delta != delta or off != floor(off)){
+    printf("coverage for %s:%d-%d was not binned on a %f nt lattice from %f\n", 
+	   chrom.c_str(), start, stop, delta, minX);
+  }else{
+    int o 	= int(off);
+    // as before, bases at or beyond the last bin edge X[0][BINS-1] are dropped
+    for (int i = 0; i < BINS-1; i++){
+      if (i+o >= 0 and i+o < coverage.forward.size()){
+	X[1][i] 	= coverage.forward[i+o];
+      }
+      if (i+o >= 0 and i+o < coverage.reverse.size()){
+	X[2][i] 	= coverage.reverse[i+o];
+      }
     }
-  }
-
-  //BIN reverse strand
-  j 	=0;
-  for (int i = 0 ; i < reverse.size(); i++){
-	  // RDD: To me this seems klunky.  Why do it this way?
-    while (j < BINS and X[0][j] <=reverse[i][0]){
-      j++;
+    for (int i = 0; i < BINS; i++){
+      fN+=X[1][i];
     }
-    if (j < BINS and reverse[i][0]<= X[0][j]){
-      X[2][j-1]+=reverse[i][1];
-      N+=reverse[i][1];
-      rN+=reverse[i][1];
+    for (int i = 0; i < BINS; i++){
+      rN+=X[2][i];
     }
+    N 	= fN + rN;
   }
 
   //===================
@@ -270,29 +311,20 @@ void segment::bin(double delta, double scale, bool erase){
     }
   }
 
-  if (erase){  // going to remove the zero bins
-    double ** newX 	= new double*[3];
-    for (int j=0; j<3;j++){
-      newX[j] 	= new double[realN];
-    }
-    j = 0;
+  if (erase){  // going to remove the zero bins, compacted in place
+    int j = 0;
     for (int i = 0; i < BINS; i ++){
       if (X[1][i]>0 or X[2][i]>0){
-	newX[0][j] 	= X[0][i];
-	newX[1][j] 	= X[1][i];
-	newX[2][j] 	= X[2][i];
+	X[0][j] 	= X[0][i];
+	X[1][j] 	= X[1][i];
+	X[2][j] 	= X[2][i];
 	j++;
       }
     }
     if (realN!=j){
       printf("WHAT? %d,%d\n", j, realN);
     }
-    //clear previous memory
-    for (int i = 0; i < 3; i ++){
-      delete X[i];
-    }
-    delete X;
-    X 				= newX;
+    X.shrink(realN);
     XN 				= realN;
   }
 
@@ -328,8 +360,41 @@ void segment::bin(double delta, double scale, bool erase){
     S+=X[1][i];
   }
   // Why do we throw away the raw data?
-  forward.clear();
-  reverse.clear();
+  coverage.clear();
+  index();
+}
+
+/**
+ * @brief Builds the running totals C from X.  Call again whenever X changes.
+ */
+void segment::index(){
+  int n 	= int(XN);
+  C.resize(2, n+1);	// zeroed
+  for (int i = 0; i < n; i++){
+    C[0][i+1] 	= C[0][i] + X[1][i];
+    C[1][i+1] 	= C[1][i] + X[2][i];
+  }
+}
+
+/**
+ * @brief Coverage of bins j ... k-1 on one strand, from the running totals.
+ * @param st X row: 1 forward, 2 reverse
+ * @param j first bin
+ * @param k one past the last bin
+ * @return double 
+ */
+double segment::sum(int st, int j, int k) const{
+  return C[st-1][k] - C[st-1][j];
+}
+
+/**
+ * @brief Binary search of the bin coordinates.
+ * @param x coordinate (scaled, as X[0])
+ * @return the first bin with X[0] >= x, XN if there is none
+ */
+int segment::find(double x) const{
+  const double * b 	= X[0];
+  return lower_bound(b, b + int(XN), x) - b;
 }
 
 //================================================================================================
@@ -381,32 +446,83 @@ node::node(vector<segment * > segments ){
 }
 
 /**
- * @brief Add a data point to all of the nodes that include this point on the tree.
- * @author Joey Azofeifa 
- * Appears to assume that you will always be adding data point to
- * the end of the forward/reverse indexed data points (sorted calls?)
- * 
- * @param x a 2D vector [x y] where X is coordinate and y is value
+ * @brief Add the bases of a run that lie strictly inside (start, stop) of an interval.
+ * @param S the interval
+ * @param x a run [start, stop) of bases each with depth x.value
+ * @param s strand (as int: 1 is forward; anything else is reverse)
+ * @return (void)
+ */
+static void add_inside(segment * S, const coverage_run & x, int s){
+  double last 	= x.start + ceil(x.stop - x.start) - 1;
+  // clip to the bases inside this interval
+  double st 	= max(x.start, x.start + ceil(S->start + 1 - x.start));
+  double sp 	= min(last, double(S->stop - 1)) + 1;
+  if (st < sp){
+    S->coverage.add(s==1 ? 1 : -1, st, sp, x.value);
+  }
+}
+
+/**
+ * @brief Hands coverage runs to the intervals of one chromosome in a single
+ * sweep.  Intervals are taken in order of start; runs must arrive in order
+ * of start too, so an interval joins the active list when a run first
+ * reaches it and leaves for good once runs start at or past its stop.
+ * Overlapping intervals are simply active at the same time.
+ */
+class coverage_sweep{
+public:
+  coverage_sweep(const vector<segment *> &);
+
+  void add(const coverage_run &, int);	// run, strand (1 forward, -1 reverse)
+  void restart();	// rewind for another pass (e.g. the reverse strand file)
+
+private:
+  vector<segment *> intervals;	//!< sorted by start
+  size_t next;			//!< first interval not yet active
+  vector<segment *> active;	//!< intervals the current run may reach
+};
+
+static bool starts_before(const segment * a, const segment * b){
+  return a->start < b->start;
+}
+
+static bool run_starts_before(const pair<coverage_run, int> & a, const pair<coverage_run, int> & b){
+  return a.first.start < b.first.start;
+}
+
+coverage_sweep::coverage_sweep(const vector<segment *> & I){
+  intervals 	= I;
+  stable_sort(intervals.begin(), intervals.end(), starts_before);
+  next 	= 0;
+}
+
+void coverage_sweep::restart(){
+  next 	= 0;
+  active.clear();
+}
+
+/**
+ * @brief Add a run to every interval holding any of its bases.
+ * Each interval only receives the bases strictly inside (start, stop).
+ * @param x a run [start, stop) of bases each with depth x.value
  * @param s strand (as int: 1 is forward; -1 is reverse)
  * @return (void)
  */
-void node::insert_coverage(vector<double> x, int s){
-  for (int i = 0 ; i < current.size(); i++){
-    if (x[0] > current[i]->start and  x[0] < current[i]->stop  ){
-      if (s==1){
-	current[i]->forward.push_back(x);
-      }else{
-	current[i]->reverse.push_back(x);	
-      }
+void coverage_sweep::add(const coverage_run & x, int s){
+  double last 	= x.start + ceil(x.stop - x.start) - 1;
+  while (next < intervals.size() and intervals[next]->start < last){
+    active.push_back(intervals[next]);
+    next++;
+  }
+  size_t keep 	= 0;
+  for (size_t i = 0; i < active.size(); i++){
+    if (active[i]->stop > x.start){	// later runs start here or further on
+      active[keep++] 	= active[i];
     }
-  }	
- 
-  // Recursively add point to all relevant intervals.
-  if (x[0] >= center and right != NULL ){
-    right->insert_coverage(x, s);
   }
-  if (x[0] <= center and left !=NULL){
-    left->insert_coverage(x,  s);
+  active.resize(keep);
+  for (size_t i = 0; i < active.size(); i++){
+    add_inside(active[i], x, s);
   }
 }
 
@@ -586,21 +702,534 @@ bool check_ID_name(string & INFO){
   return PASSED;
 }
 
+/**
+ * @brief What one chunk (a byte range of whole lines) of a bedgraph holds.
+ * Chunks are scanned on separate threads and combined in file order.
+ */
+class bedgraph_chunk{
+public:
+  int file;		//!< index of the input file
+  size_t begin;		//!< first byte
+  size_t end;		//!< one past the last byte
+  int lines;		//!< well formed lines read
+  int bad;		//!< first malformed line (counted within the chunk), -1 if none
+  string bad_line;	//!< its text
+  int other;		//!< first line not on spec_chrom, -1 if none (or spec_chrom is "all")
+  int past;		//!< first line not on spec_chrom after one that was, -1 if none
+  map<string, chrom_extent> G;	//!< chromosome -> extents and lines within the chunk
+  set<string> covered;	//!< chromosomes with a line that covers some base
+  map<string, pair<int, int> > starts;	//!< chromosome -> first and last start in the chunk
+  set<string> unsorted;	//!< chromosomes whose starts go down within the chunk
+
+  bedgraph_chunk(int f, size_t b, size_t e){ file = f, begin = b, end = e, lines = 0, bad = -1, other = -1, past = -1; }
+};
+
+static const size_t chunk_bytes 	= 1<<20;	//!< smallest chunk worth a thread
+
+/**
+ * @brief Record a chunk's lines per chromosome: where they are and the bases
+ * they cover.  A chromosome's extents start out as its first line (as
+ * segment(chrom, start, stop) does) until a line covering some base is seen.
+ * With a spec_chrom the scan stops at the first line after a run of its lines.
+ * @param FH the open file the chunk is from (only its buffer is used)
+ * @param spec_chrom a specified chromosome name, can be "all"
+ * @param K the chunk, filled in
+ * @return (void)
+ */
+static void scan_chunk(const bedgraph_reader & FH, const string & spec_chrom, bedgraph_chunk & K){
+  bedgraph_reader R;
+  if (not R.attach(FH)){
+    return;
+  }
+  R.seek(K.begin, K.end);
+  bg_record rec;
+  string prevChrom 	= "";
+  chrom_extent * E 	= NULL;
+  pair<int, int> * St 	= NULL;
+  size_t begin 	= R.offset();
+  bool on_spec 	= false;
+  while (R.next(rec)){
+    if (not rec.valid){
+      K.bad 	= K.lines;
+      K.bad_line 	= rec.line.str();
+      return;
+    }
+    if (K.lines==0 or rec.chrom != prevChrom){
+      prevChrom 	= rec.chrom.str();
+      E 	= NULL;
+      if (spec_chrom!="all"){
+	if (prevChrom==spec_chrom){
+	  on_spec 	= true;
+	}else{
+	  K.other 	= (K.other < 0) ? K.lines : K.other;
+	  if (on_spec){
+	    K.past 	= K.lines;
+	    return;
+	  }
+	}
+      }
+      if (spec_chrom=="all" or prevChrom==spec_chrom){
+	map<string, chrom_extent>::iterator g 	= K.G.find(prevChrom);
+	if (g==K.G.end()){
+	  g 	= K.G.insert(make_pair(prevChrom, chrom_extent(prevChrom, rec.start, rec.stop))).first;
+	}
+	E 	= &g->second;
+	St 	= &K.starts.insert(make_pair(prevChrom, make_pair(rec.start, rec.start))).first->second;
+      }
+    }
+    K.lines++;
+    if (E!=NULL){
+      if (rec.start < St->second){
+	K.unsorted.insert(prevChrom);
+      }
+      St->second 	= rec.start;
+      if (rec.stop > rec.start){
+	// as segment::add_run
+	double last 	= rec.start + ceil(double(rec.stop) - rec.start) - 1;
+	if (K.covered.insert(prevChrom).second){
+	  E->lo = rec.start, E->hi = last;
+	}else{
+	  E->lo = min(E->lo, double(rec.start)), E->hi = max(E->hi, last);
+	}
+      }
+      if (not E->blocks.empty() and E->blocks.back().end==begin){
+	E->blocks.back().end 	= R.offset();
+      }else{
+	E->blocks.push_back(line_block(K.file, begin, R.offset()));
+      }
+    }
+    begin 	= R.offset();
+  }
+}
+
+/**
+ * @brief Read each file only up to the end of its first run of spec_chrom
+ * lines, as a line by line read that stops there would: the line that ends
+ * the run is the last one read (and checked), later chunks are dropped.
+ * @param K scanned chunks, in file order
+ * @return (void)
+ */
+static void stop_after_chrom(vector<bedgraph_chunk> & K){
+  vector<bedgraph_chunk> kept;
+  bool seen 	= false;	// a spec_chrom line in an earlier chunk of this file
+  bool stopped 	= false;
+  for (int k = 0; k < K.size(); k++){
+    if (k > 0 and K[k].file != K[k-1].file){
+      seen = false, stopped = false;
+    }
+    if (stopped){
+      continue;
+    }
+    int stop 	= seen ? K[k].other : K[k].past;
+    if (stop >= 0 and (K[k].bad < 0 or K[k].bad > stop)){
+      if (seen and stop==0){	// the run ended with the previous chunk
+	K[k].G.clear(), K[k].covered.clear(), K[k].starts.clear(), K[k].unsorted.clear();
+      }
+      K[k].bad 	= -1;
+      K[k].lines 	= stop + 1;
+      stopped 	= true;
+    }
+    seen 	= seen or not K[k].G.empty();
+    kept.push_back(K[k]);
+  }
+  K.swap(kept);
+}
+
+/**
+ * @brief Split the open files into chunks of whole lines and scan them on
+ * all OpenMP threads; the chunks of every file (i.e. both strands) are
+ * scanned at the same time.
+ * @param FH open readers, one per input file
+ * @param files number of input files
+ * @param spec_chrom a specified chromosome name, can be "all"
+ * @return the scanned chunks, in file order
+ */
+static vector<bedgraph_chunk> scan_bedgraphs(bedgraph_reader * FH, int files, const string & spec_chrom){
+  int num_proc 	= omp_get_max_threads();
+  vector<bedgraph_chunk> K;
+  for (int u = 0; u < files; u++){
+    size_t size 	= FH[u].size();
+    size_t parts 	= max(size_t(1), min(size_t(4*num_proc), size / chunk_bytes));
+    size_t b 	= 0;
+    for (size_t p = 1; p <= parts; p++){
+      size_t e 	= (p==parts) ? size : FH[u].line_start(size / parts * p);
+      if (e > b){
+	K.push_back(bedgraph_chunk(u, b, e));
+      }
+      b 	= e;
+    }
+  }
+  #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+  for (int k = 0; k < K.size(); k++){
+    scan_chunk(FH[K[k].file], spec_chrom, K[k]);
+  }
+  if (spec_chrom!="all"){
+    stop_after_chrom(K);
+  }
+  return K;
+}
+
+/**
+ * @brief The first malformed line over all chunks, in file order.
+ * @param K scanned chunks
+ * @param line_number the well formed lines read before it, counted on across
+ * files (0 based)
+ * @return index of the chunk holding it, -1 if every line was well formed
+ */
+static int first_bad_chunk(const vector<bedgraph_chunk> & K, int & line_number){
+  line_number 	= 0;
+  for (int k = 0; k < K.size(); k++){
+    if (K[k].bad >= 0){
+      line_number 	+= K[k].bad;
+      return k;
+    }
+    line_number 	+= K[k].lines;
+  }
+  return -1;
+}
+
+/**
+ * @brief Combine scanned chunks, in file order, into per chromosome extents
+ * and line blocks (the same as one pass over the files would find).
+ * @param K scanned chunks
+ * @param G chromosome -> extents and lines
+ * @param in_first chromosomes seen in the first input file
+ * @param unsorted (chromosome, file) whose lines are not in order of start
+ * @return (void)
+ */
+static void merge_chunks(const vector<bedgraph_chunk> & K, map<string, chrom_extent> & G, 
+		set<string> & in_first, set<pair<string, int> > & unsorted){
+  set<string> covered;
+  map<pair<string, int>, int> last;	// last start seen so far
+  for (int k = 0; k < K.size(); k++){
+    typedef map<string, pair<int, int> >::const_iterator st_type;
+    for (st_type s = K[k].starts.begin(); s != K[k].starts.end(); s++){
+      pair<string, int> key(s->first, K[k].file);
+      map<pair<string, int>, int>::iterator l 	= last.find(key);
+      if (K[k].unsorted.count(s->first) or (l!=last.end() and s->second.first < l->second)){
+	unsorted.insert(key);
+      }
+      last[key] 	= s->second.second;
+    }
+    typedef map<string, chrom_extent>::const_iterator it_type;
+    for (it_type c = K[k].G.begin(); c != K[k].G.end(); c++){
+      const chrom_extent & P 	= c->second;
+      bool was_covered 	= covered.count(c->first);
+      bool is_covered 	= K[k].covered.count(c->first);
+      if (K[k].file==0){ in_first.insert(c->first); }
+      map<string, chrom_extent>::iterator g 	= G.find(c->first);
+      if (g==G.end()){
+	G.insert(make_pair(c->first, P));
+	if (is_covered){ covered.insert(c->first); }
+	continue;
+      }
+      chrom_extent & E 	= g->second;
+      if (is_covered and not was_covered){
+	E.lo = P.lo, E.hi = P.hi;
+	covered.insert(c->first);
+      }else if (is_covered){
+	E.lo = min(E.lo, P.lo), E.hi = max(E.hi, P.hi);
+      }
+      for (int b = 0; b < P.blocks.size(); b++){
+	const line_block & B 	= P.blocks[b];
+	if (not E.blocks.empty() and E.blocks.back().file==B.file and E.blocks.back().end==B.begin){
+	  E.blocks.back().end 	= B.end;
+	}else{
+	  E.blocks.push_back(B);
+	}
+      }
+    }
+  }
+}
+
+/**
+ * @brief Bin one chunk's lines for a chromosome on the chromosome's lattice
+ * (bins at lo + b*delta).  The partial sums start at the bin holding the
+ * chunk's first base, so they only span what the chunk covers.
+ * @param FH the open file the chunk is from (only its buffer is used)
+ * @param P the chromosome's extents and lines within the chunk
+ * @param lo the chromosome's first base
+ * @param BINS how many bases per smoothing
+ * @param out the partial sums (see coverage_bins::merge)
+ * @return (void)
+ */
+static void bin_chunk(const bedgraph_reader & FH, const chrom_extent & P, double lo, int BINS, 
+		coverage_bins & out){
+  out.reset(BINS, lo + floor((P.lo - lo)/BINS)*BINS, true);
+  bedgraph_reader R;
+  if (not R.attach(FH)){
+    return;
+  }
+  bg_record rec;
+  for (int b = 0; b < P.blocks.size(); b++){
+    const line_block & B 	= P.blocks[b];
+    R.seek(B.begin, B.end);
+    while (R.next(rec)){
+      // strand as add_bedgraph_line
+      double coverage 	= float(rec.coverage);
+      out.add((B.file==0 and coverage > 0) ? 1 : -1, rec.start, rec.stop, abs(coverage));
+    }
+  }
+}
+
+/**
+ * @brief Add one bedgraph line to a chromosome's segment.
+ * @param S segment for the chromosome
+ * @param u index of the file the line came from
+ * @param start first base
+ * @param stop one past the last base
+ * @param coverage signed coverage from the file
+ * @return (void)
+ */
+static void add_bedgraph_line(segment * S, int u, int start, int stop, double coverage){
+  if (u==0){ // When u=0 we are either an ij file or positive strand
+    //If an ij file, then coverage sign indicates strand
+    if (coverage > 0) {  
+      S->add_run(1, start, stop, abs(coverage));
+    } else {
+      // so zero coverage is always neg strand?!?
+      // What happens if give positive file with zeros!!!?!
+      S->add_run(-1, start, stop, abs(coverage));
+    }
+  } else {  // If more than one input file, subsequent is neg strand
+    S->add_run(-1, start, stop, abs(coverage));
+  }
+}
+
+/**
+ * @brief Chromosomes load_bedgraphs_total() makes a segment for.
+ * @param chrom name
+ * @param in_first seen in the first (or only) input file
+ */
+static bool loadable_chrom(const string & chrom, bool in_first){
+  // Why are we restricting chromosome sizes to 6 characters??
+  return chrom.size() < 6 and in_first;
+}
+
+/**
+ * @brief Fill a chromosome's segment from a cache (not yet binned).
+ * Bins start at the chromosome's first base, as with the bedgraph path.
+ * @param CC an open cache
+ * @param i chromosome index in the cache
+ * @param BINS how many bases per smoothing
+ * @return a new segment
+ */
+static segment * cached_segment(coverage_cache & CC, int i, int BINS){
+  const cov_chrom & C 	= CC.chrom(i);
+  segment * S 	= new segment(CC.name(i), C.lo, C.hi);
+  S->coverage.reset(BINS, C.lo, false);
+  for (int s = 0; s < 2; s++){
+    const cov_run * R 	= CC.runs(i, s);
+    for (uint64_t k = 0; k < C.count[s]; k++){
+      S->add_run(s==0 ? 1 : -1, R[k].start, R[k].stop, float(R[k].value));
+    }
+  }
+  return S;
+}
+
+/**
+ * @brief load_bedgraphs_total() for a .tfitcov cache: one segment per chromosome.
+ * Applies the same chromosome rules as the bedgraph path (name shorter than 6
+ * characters, present in the first input file) and bins on the lattice that
+ * starts at each chromosome's first base, so X comes out the same.
+ * @param CC an open cache
+ * @param BINS how many bases per smoothing
+ * @param scale what is the scaling constant
+ * @param spec_chrom a specified chromosome name, can be "all"
+ * @param chromosomes maps chromsome name to ID
+ * @param ID_to_chrom maps ID to chromosome name
+ * @return a vector of segments
+ */
+static vector<segment*> load_cached_coverage(coverage_cache & CC, int BINS, double scale, 
+		string spec_chrom, map<string, int>& chromosomes, map<int, string>& ID_to_chrom){
+  vector<segment*> segments;
+  bool FOUND 	= (spec_chrom=="all");
+  int c 	= 1;
+  for (int i = 0; i < CC.chroms(); i++){
+    string chrom 	= CC.name(i);
+    if (spec_chrom!="all" and chrom!=spec_chrom){
+      continue;
+    }
+    FOUND 	= true;
+    if (not loadable_chrom(chrom, CC.chrom(i).flags & COV_IN_FIRST)){
+      continue;
+    }
+    segment * S 	= cached_segment(CC, i, BINS);
+    S->bin(BINS, scale, false);
+    if (chromosomes.find(S->chrom)==chromosomes.end()){
+      chromosomes[S->chrom]=c;
+      ID_to_chrom[c] 	= S->chrom;
+      c++;
+    }
+    segments.push_back(S);
+  }
+  if (not FOUND){
+    segments.clear();
+    printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+  }
+  return segments;
+}
+
+/**
+ * @brief Open the input files as bigWigs if they are.
+ * @param FILES {joint} or {forward, reverse}
+ * @param BW readers, one per file
+ * @return 1 if every file is a bigWig (now open), 0 if none is, -1 on error
+ */
+static int open_bigwigs(const vector<string> & FILES, bigwig_reader * BW){
+  int n 	= 0;
+  for (int u = 0; u < FILES.size(); u++){
+    n 	+= bigwig_reader::is_bigwig(FILES[u]);
+  }
+  if (n==0){
+    return 0;
+  }
+  if (n != FILES.size()){
+    printf("either all or none of the coverage files may be bigWig\n");
+    return -1;
+  }
+  for (int u = 0; u < FILES.size(); u++){
+    if (not BW[u].open(FILES[u])){
+      return -1;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief First and last base of a chromosome over the bigWig inputs, read
+ * off the R-tree index alone (nothing is inflated).
+ * @param BW open readers
+ * @param files number of readers
+ * @param chrom chromosome name
+ * @param lo first base covered
+ * @param hi last base covered
+ * @return false if no file has coverage on chrom
+ */
+static bool bigwig_extent(const bigwig_reader * BW, int files, const string & chrom, 
+		double & lo, double & hi){
+  bool any 	= false;
+  for (int u = 0; u < files; u++){
+    int c 	= BW[u].find(chrom);
+    vector<bw_block> B 	= BW[u].blocks(c, 0, c < 0 ? 0 : BW[u].size(c));
+    for (int b = 0; b < B.size(); b++){
+      if (B[b].end <= B[b].start){
+	continue;
+      }
+      if (not any){
+	lo = B[b].start, hi = B[b].end - 1.;
+	any 	= true;
+      }else{
+	lo = min(lo, double(B[b].start)), hi = max(hi, B[b].end - 1.);
+      }
+    }
+  }
+  return any;
+}
+
+/**
+ * @brief Add the bigWig coverage of a segment's chromosome between start and
+ * end to it (not yet binned); only the blocks overlapping are inflated.
+ * Strands follow add_bedgraph_line.
+ * @param S the segment (its chrom is looked up in every file)
+ * @param BW open readers
+ * @param files number of readers
+ * @param start first base wanted
+ * @param end one past the last base wanted
+ * @return false if a block was corrupt
+ */
+static bool add_bigwig(segment * S, const bigwig_reader * BW, int files, uint32_t start, uint32_t end){
+  vector<bw_item> items;
+  for (int u = 0; u < files; u++){
+    int c 	= BW[u].find(S->chrom);
+    vector<bw_block> B 	= BW[u].blocks(c, start, end);
+    for (int b = 0; b < B.size(); b++){
+      if (not BW[u].read(B[b], items)){
+	printf("corrupt bigWig block at byte %llu\n", (unsigned long long)B[b].offset);
+	return false;
+      }
+      for (int i = 0; i < items.size(); i++){
+	if (items[i].chrom == uint32_t(c) and items[i].end > start and items[i].start < end){
+	  add_bedgraph_line(S, u, items[i].start, items[i].end, items[i].value);
+	}
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief A chromosome's segment from bigWig input (not yet binned).
+ * @param BW open readers
+ * @param files number of readers
+ * @param E the chromosome and its extents
+ * @param BINS how many bases per smoothing
+ * @return a new segment; NULL if a data block was corrupt
+ */
+static segment * bigwig_segment(const bigwig_reader * BW, int files, const chrom_extent & E, int BINS){
+  segment * S 	= new segment(E.chrom, E.lo, E.hi);
+  S->coverage.reset(BINS, E.lo, false);
+  if (not add_bigwig(S, BW, files, 0, uint32_t(E.hi) + 1)){
+    delete S;
+    return NULL;
+  }
+  return S;
+}
+
+/**
+ * @brief The chromosomes of bigWig input load_bedgraphs_total() makes a
+ * segment for (see loadable_chrom), sorted by name, with their extents.
+ * @param BW open readers
+ * @param files number of readers
+ * @param spec_chrom a specified chromosome name, can be "all"
+ * @param FOUND set if spec_chrom is in any file
+ */
+static vector<chrom_extent> index_bigwigs(const bigwig_reader * BW, int files, 
+		const string & spec_chrom, bool & FOUND){
+  set<string> names;
+  for (int u = 0; u < files; u++){
+    for (int c = 0; c < BW[u].chroms(); c++){
+      if (spec_chrom=="all" or BW[u].name(c)==spec_chrom){
+	names.insert(BW[u].name(c));
+      }
+    }
+  }
+  FOUND 	= FOUND or not names.empty();
+  vector<chrom_extent> index;
+  for (set<string>::iterator n = names.begin(); n != names.end(); n++){
+    double lo, hi;
+    if (loadable_chrom(*n, BW[0].find(*n) >= 0) and bigwig_extent(BW, files, *n, lo, hi)){
+      index.push_back(chrom_extent(*n, lo, hi));
+    }
+  }
+  return index;
+}
+
 //================================================================================================
 /**
  * @brief Parses a bedgraph into a collection of segments.
  * Also populates information on chromosomes seen within the bedgraph file and 
  * does the data scaling and smoothing.
  * 
+ * The files are cut into chunks of whole lines that are parsed on all OpenMP
+ * threads, forward and reverse files at the same time: one pass finds each
+ * chromosome's extents and lines, a second bins every chunk's share of a
+ * chromosome into partial sums (see coverage_bins) which are added up in
+ * file order, so the raw bedgraph is never held in memory.  X is identical
+ * to a single threaded read for integer coverage; fractional sums may differ
+ * in the last bits where a bin straddles a chunk boundary.  A .tfitcov
+ * cache given as the joint file is read instead of parsing text (see
+ * coverage_cache), as are bigWig files (see bigwig_reader).
+ *
  * Assumptions:
  *    Assumes either joint_bedgraph or (forward_strand reverse_strand) are specified (e.g. not empty)
  *    Has a very hard coded 6 character limit on chromsome name (WHY????)
  * 
  * @author Joey Azofeifa 
  * 
- * @param forward_strand Filename of forward strand data 
- * @param reverse_strand Filename of reverse strand data
- * @param joint_bedgraph Filename of joint data (ij)
+ * @param forward_strand Filename of forward strand data (bedgraph or bigWig)
+ * @param reverse_strand Filename of reverse strand data (bedgraph or bigWig)
+ * @param joint_bedgraph Filename of joint data (ij), may be a .tfitcov cache or bigWig
  * @param BINS how many bases per smoothing -- for bin() function
  * @param scale what is the scaling constant 
  * @param spec_chrom a specified chromosome name, can be "all"
@@ -621,13 +1250,11 @@ vector<segment*> load::load_bedgraphs_total(string forward_strand, string revers
 
   vector<string> FILES;	// Keep file names
   int line_number = 0;
-  vector<string> lineArray; // Contents of file, split on tab (\t) 
-  string line, chrom;
-  int start, stop;
-  double coverage;
+  int num_proc 	= omp_get_max_threads();
 
   segment * S =NULL;
-  map<string, segment*> G;  // Data associated with a chrom name
+  map<string, chrom_extent> G;  // Extents and lines associated with a chrom name
+  set<string> in_first;	// chroms seen in the first file
   vector<segment*> segments;	// returned variable
  
   if (forward_strand.empty() and reverse_strand.empty()){
@@ -635,84 +1262,119 @@ vector<segment*> load::load_bedgraphs_total(string forward_strand, string revers
   }else if (not forward_strand.empty() and not reverse_strand.empty()){
     FILES 	= {forward_strand, reverse_strand};  // Distinct files per strand
   }
-  
+  bedgraph_reader FH[2];
+
+  // A cache (see coverage_cache) already holds the runs per chromosome
+  if (FILES.size()==1 and coverage_cache::is_cache(FILES[0])){
+    coverage_cache CC;
+    if (not CC.open(FILES[0])){
+      return segments;
+    }
+    return load_cached_coverage(CC, BINS, scale, spec_chrom, chromosomes, ID_to_chrom);
+  }
+  // bigWig input: extents come from the index, chromosomes load in parallel
+  bigwig_reader BW[2];
+  int bigwig 	= open_bigwigs(FILES, BW);
+  if (bigwig < 0){
+    return segments;
+  }
+  if (bigwig){
+    vector<chrom_extent> index 	= index_bigwigs(BW, FILES.size(), spec_chrom, FOUND);
+    segments.resize(index.size(), NULL);
+    #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+    for (int i = 0; i < index.size(); i++){
+      segments[i] 	= bigwig_segment(BW, FILES.size(), index[i], BINS);
+      if (segments[i] != NULL){
+	segments[i]->bin(BINS, scale, false);
+      }
+    }
+    if (find(segments.begin(), segments.end(), (segment *)NULL) != segments.end()){
+      clear_segments(segments);
+      segments.clear();
+      return segments;
+    }
+    int c = 1;
+    for (int i = 0; i < segments.size(); i++){
+      if (chromosomes.find(segments[i]->chrom)==chromosomes.end()){
+	chromosomes[segments[i]->chrom]=c;
+	ID_to_chrom[c] 	= segments[i]->chrom;
+	c++;
+      }
+    }
+    if (not FOUND){
+      printf("couldn't find chromosome %s in bigWig files\n", spec_chrom.c_str());
+    }
+    return segments;
+  }
+
+  // First pass: every file is cut into chunks of whole lines which are
+  // scanned in parallel for each chromosome's extents and lines.
   for (int u = 0 ; u < FILES.size(); u++){
-	  bool INSERT     = false;	  
-	  string prevChrom="";	// What chrom was on the previous line?
-	  ifstream FH(FILES[u]) ;
-	  if (not FH){ printf("couln't open FILE %s\n", FILES[u].c_str()); }
-	  if (EXIT){ break; }
-
-	  // For every line in this file...
-	  while (getline(FH, line)){
-		  lineArray=string_split(line, '\t');
-		  // Have a hard requirement for a four column bed input
-		  if (lineArray.size()!=4){
-			  EXIT 	= true;
-			  printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n",line_number, FILES[u].c_str() );
-			  break;
+    if (not FH[u].open(FILES[u])){ printf("couln't open FILE %s\n", FILES[u].c_str()); }
+  }
+  vector<bedgraph_chunk> K 	= scan_bedgraphs(FH, FILES.size(), spec_chrom);
+  int bad 	= first_bad_chunk(K, line_number);
+  if (bad >= 0){
+    // Have a hard requirement for a four column bed input
+    EXIT 	= true;
+    printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n",line_number, FILES[K[bad].file].c_str() );
+  }else{
+    set<pair<string, int> > unsorted;	// not needed, the extents are known before binning
+    merge_chunks(K, G, in_first, unsorted);
+  }
+  if (not G.empty()){
+    FOUND 	= true;
+  }
+
+  if (not EXIT) { // EXIT only true if not right format file
+	  // Only chromosomes in the first file get a segment; the bins start at
+	  // each chromosome's first base, known now so nothing needs re-reading.
+	  typedef map<string, chrom_extent>::iterator it_type;
+	  for (it_type i = G.begin(); i != G.end(); i++){
+		  if (loadable_chrom(i->first, in_first.count(i->first))){
+			  S 	= new segment(i->first, i->second.lo, i->second.hi);
+			  S->coverage.reset(BINS, i->second.lo, false);
+			  segments.push_back(S);
 		  }
-		  line_number++;
-	      // Expects: chrom_name \t start \t stop \t coverage \n
-		  chrom=lineArray[0], start=stoi(lineArray[1]), stop=stoi(lineArray[2]), coverage=(stof(lineArray[3]));
-
-		  if (chrom != prevChrom and (chrom==spec_chrom or spec_chrom=="all")  )  {
-			  FOUND 		= true;
-			  // Why are we restricting chromosome sizes to 6 characters??
-			  if (chrom.size()<6){
-				  INSERT          = true;
-				  FOUND           = true;
-			  }
-			  if (chrom.size() < 6 and u==0){
-				  G[chrom] 	= new segment(chrom, start, stop);
-				  INSERT 		= true;
-				  FOUND 		= true;
-			  } else if(chrom.size() > 6){
-				  INSERT 		= false;
+	  }
+	  // Second pass: each chunk bins its share of a chromosome on its own
+	  // thread, then the pieces are summed in file order.
+	  vector<pair<int, int> > pieces;	// (chunk, segment)
+	  vector<vector<int> > of_segment(segments.size());	// segment -> its pieces
+	  for (int k = 0; k < K.size(); k++){
+		  for (int s = 0; s < segments.size(); s++){
+			  if (K[k].covered.count(segments[s]->chrom)){
+				  of_segment[s].push_back(pieces.size());
+				  pieces.push_back(make_pair(k, s));
 			  }
 		  }
-		  if (FOUND and chrom!= spec_chrom and spec_chrom!= "all"){
-			  break;
-		  }
-		  if (INSERT){
-			  if (u==0){ // When u=0 we are either an ij file or positive strand
-				  //If an ij file, then coverage sign indicates strand
-				  if (coverage > 0) {  
-					  for (int xx = start; xx < stop; xx++){
-						  G[chrom]->add2(1, double(xx), abs(coverage));
-					  }
-				  } else {
-					  // so zero coverage is always neg strand?!?
-					  // What happens if give positive file with zeros!!!?!
-					  for (int xx = start; xx < stop; xx++){
-						  G[chrom]->add2(-1, xx, abs(coverage));						
-					  }
-				  }
-			  } else {  // If more than one input file, subsequent is neg strand
-				  for (int xx = start; xx < stop; xx++){
-					  G[chrom]->add2(-1, xx, abs(coverage));	
-				  }
+	  }
+	  vector<coverage_bins> partial(pieces.size());
+	  #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+	  for (int p = 0; p < pieces.size(); p++){
+		  const bedgraph_chunk & C 	= K[pieces[p].first];
+		  segment * T 	= segments[pieces[p].second];
+		  bin_chunk(FH[C.file], C.G.find(T->chrom)->second, T->minX, BINS, partial[p]);
+	  }
+	  #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+	  for (int s = 0; s < segments.size(); s++){
+		  for (int q = 0; q < of_segment[s].size(); q++){
+			  coverage_bins & P 	= partial[of_segment[s][q]];
+			  if (not segments[s]->coverage.merge(P)){
+				  printf("couldn't combine coverage for %s\n", segments[s]->chrom.c_str());
 			  }
+			  P.clear();
 		  }
-		  prevChrom=chrom;
-
+		  segments[s]->bin(BINS, scale, false);	// Scale and smooth data
 	  }
-  }
-  if (not EXIT) { // EXIT only true if not right format file
+	  // Building the naming cross referencing: chromosomes, ID_to_chrom
 	  int c = 1;
-	  typedef map<string, segment*>::iterator it_type;
-
-      // For each chromosome in G (each has a single segment?) 
-	  for (it_type i = G.begin(); i != G.end(); i++){
-		  i->second->bin(BINS, scale, false);	// Scale and smooth data
-		  // Building the naming cross referencing: chromosomes, ID_to_chrom
-		  if (chromosomes.find(i->second->chrom)==chromosomes.end()){
-			  chromosomes[i->second->chrom]=c;
-			  ID_to_chrom[c] 	= i->second->chrom;
+	  for (int s = 0; s < segments.size(); s++){
+		  if (chromosomes.find(segments[s]->chrom)==chromosomes.end()){
+			  chromosomes[segments[s]->chrom]=c;
+			  ID_to_chrom[c] 	= segments[s]->chrom;
 			  c++;
 		  }
-	      // Puts this segment into the return collection
-		  segments.push_back(i->second);
 	  }
   }
   if (not FOUND){
@@ -722,6 +1384,177 @@ vector<segment*> load::load_bedgraphs_total(string forward_strand, string revers
   return segments;
 }
 
+/**
+ * @brief One (parallel, see load_bedgraphs_total) pass over the input
+ * recording, per chromosome, its extents and where its lines are, without
+ * keeping any coverage.  Lets a caller load a few chromosomes at a time (see
+ * load_chromosomes) with bounded memory.
+ * Only the chromosomes load_bedgraphs_total() would make a segment for are
+ * returned, sorted by name (the same order it returns segments in).
+ * @param forward_strand Filename of forward strand data
+ * @param reverse_strand Filename of reverse strand data
+ * @param joint_bedgraph Filename of joint data (ij), may be a .tfitcov cache or bigWig
+ * @param spec_chrom a specified chromosome name, can be "all"
+ * @return the chromosomes; empty if none were found or the input is malformed
+ */
+vector<chrom_extent> load::index_bedgraphs(string forward_strand, string reverse_strand, 
+		string joint_bedgraph, string spec_chrom){
+  vector<chrom_extent> index;
+  vector<string> FILES;
+  if (forward_strand.empty() and reverse_strand.empty()){
+    FILES 	= {joint_bedgraph};
+  }else{
+    FILES 	= {forward_strand, reverse_strand};
+  }
+  bool FOUND 	= (spec_chrom=="all");
+  if (FILES.size()==1 and coverage_cache::is_cache(FILES[0])){
+    coverage_cache CC;
+    if (not CC.open(FILES[0])){
+      return index;
+    }
+    for (int i = 0; i < CC.chroms(); i++){
+      string chrom 	= CC.name(i);
+      if (spec_chrom!="all" and chrom!=spec_chrom){
+	continue;
+      }
+      FOUND 	= true;
+      if (loadable_chrom(chrom, CC.chrom(i).flags & COV_IN_FIRST)){
+	index.push_back(chrom_extent(chrom, CC.chrom(i).lo, CC.chrom(i).hi));
+      }
+    }
+  }else if (bigwig_reader::is_bigwig(FILES[0])){
+    bigwig_reader BW[2];
+    if (open_bigwigs(FILES, BW) < 1){
+      return index;
+    }
+    index 	= index_bigwigs(BW, FILES.size(), spec_chrom, FOUND);
+  }else{
+    map<string, chrom_extent> G;
+    set<string> in_first;
+    bedgraph_reader FH[2];
+    for (int u = 0; u < FILES.size(); u++){
+      if (not FH[u].open(FILES[u])){
+	printf("couln't open FILE %s\n", FILES[u].c_str());
+	return index;
+      }
+    }
+    vector<bedgraph_chunk> K 	= scan_bedgraphs(FH, FILES.size(), spec_chrom);
+    int line_number;
+    int bad 	= first_bad_chunk(K, line_number);
+    if (bad >= 0){
+      printf("\nLine number %d  in file %s was not formatted properly\nPlease see manual\n",line_number, FILES[K[bad].file].c_str() );
+      return index;
+    }
+    set<pair<string, int> > unsorted;
+    merge_chunks(K, G, in_first, unsorted);
+    if (not G.empty()){
+      FOUND 	= true;
+    }
+    for (map<string, chrom_extent>::iterator g = G.begin(); g != G.end(); g++){
+      if (loadable_chrom(g->first, in_first.count(g->first))){
+	index.push_back(g->second);
+      }
+    }
+  }
+  if (not FOUND){
+    printf("couldn't find chromosome %s in bedgraph files\n", spec_chrom.c_str());
+  }
+  return index;
+}
+
+/**
+ * @brief Load, bin and scale just the given chromosomes (see index_bedgraphs).
+ * Only the indexed lines are read; each chromosome is binned from its first
+ * base, the same lattice load_bedgraphs_total() ends up on.
+ * @param forward_strand Filename of forward strand data
+ * @param reverse_strand Filename of reverse strand data
+ * @param joint_bedgraph Filename of joint data (ij), may be a .tfitcov cache or bigWig
+ * @param which chromosomes to load
+ * @param BINS how many bases per smoothing
+ * @param scale what is the scaling constant
+ * @return one segment per chromosome, in the order given; empty on error
+ */
+vector<segment*> load::load_chromosomes(string forward_strand, string reverse_strand, 
+		string joint_bedgraph, const vector<chrom_extent>& which, int BINS, double scale){
+  vector<segment*> segments;
+  vector<string> FILES;
+  if (forward_strand.empty() and reverse_strand.empty()){
+    FILES 	= {joint_bedgraph};
+  }else{
+    FILES 	= {forward_strand, reverse_strand};
+  }
+  if (FILES.size()==1 and coverage_cache::is_cache(FILES[0])){
+    coverage_cache CC;
+    if (not CC.open(FILES[0])){
+      return segments;
+    }
+    for (int i = 0; i < which.size(); i++){
+      int c 	= CC.find(which[i].chrom);
+      if (c < 0){
+	printf("couldn't find chromosome %s in %s\n", which[i].chrom.c_str(), FILES[0].c_str());
+	clear_segments(segments);
+	segments.clear();
+	return segments;
+      }
+      segment * S 	= cached_segment(CC, c, BINS);
+      S->bin(BINS, scale, false);
+      segments.push_back(S);
+    }
+    return segments;
+  }
+  int num_proc 	= omp_get_max_threads();
+  bigwig_reader BW[2];
+  int bigwig 	= open_bigwigs(FILES, BW);
+  if (bigwig < 0){
+    return segments;
+  }
+  if (bigwig){
+    segments.resize(which.size(), NULL);
+    #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+    for (int i = 0; i < which.size(); i++){
+      segments[i] 	= bigwig_segment(BW, FILES.size(), which[i], BINS);
+      if (segments[i] != NULL){
+	segments[i]->bin(BINS, scale, false);
+      }
+    }
+    if (find(segments.begin(), segments.end(), (segment *)NULL) != segments.end()){
+      clear_segments(segments);
+      segments.clear();
+    }
+    return segments;
+  }
+  bedgraph_reader FH[2];
+  for (int u = 0; u < FILES.size(); u++){
+    if (not FH[u].open(FILES[u])){
+      printf("couln't open FILE %s\n", FILES[u].c_str());
+      return segments;
+    }
+  }
+  // one chromosome per thread, each reading its own lines
+  segments.resize(which.size(), NULL);
+  #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+  for (int i = 0; i < which.size(); i++){
+    const chrom_extent & E 	= which[i];
+    bedgraph_reader R[2];
+    bg_record rec;
+    for (int u = 0; u < FILES.size(); u++){
+      R[u].attach(FH[u]);
+    }
+    segment * S 	= new segment(E.chrom, E.lo, E.hi);
+    S->coverage.reset(BINS, E.lo, false);
+    for (int b = 0; b < E.blocks.size(); b++){
+      const line_block & B 	= E.blocks[b];
+      R[B.file].seek(B.begin, B.end);
+      while (R[B.file].next(rec)){
+	add_bedgraph_line(S, B.file, rec.start, rec.stop, float(rec.coverage));
+      }
+    }
+    S->bin(BINS, scale, false);
+    segments[i] 	= S;
+  }
+  return segments;
+}
+
 /**
  * @brief 
  * @author Joey Azofeifa 
@@ -831,35 +1664,37 @@ vector<segment*> load::load_intervals_of_interest(string FILE, map<int, string>&
 }
 
 /**
- * @brief 
+ * @brief Fill intervals of interest with coverage from the bedgraphs.
+ * Each chromosome is one sweep over its intervals and lines in order of
+ * start (see coverage_sweep), linear in both; lines that are out of order
+ * are sorted first.  Overlapping intervals each get the coverage.  With
+ * bigWig input only the data blocks overlapping the intervals are read.
  * @author Joey Azofeifa 
  * @param A mapping of chrom name to segment array
- * @param forward Filename of forward strand data 
- * @param reverse Filename of reverse strand data
- * @param joint Filename of joint data (ij)
+ * @param forward Filename of forward strand data (bedgraph or bigWig)
+ * @param reverse Filename of reverse strand data (bedgraph or bigWig)
+ * @param joint Filename of joint data (ij), may be a .tfitcov cache or bigWig
+ * @param BINS how many bases per smoothing -- coverage is binned on the fly
  * @param rank MPI process number
- * @return a vector of segments
+ * @return a vector of segments; empty if the input was malformed or corrupt
  */
 vector<segment* > load::insert_bedgraph_to_segment_joint(map<string, vector<segment *> > A , 
-    string forward, string reverse, string joint, int rank ){
+    string forward, string reverse, string joint, int BINS, int rank ){
 
   bool debug = true;
-  map<string, node> NT;
   typedef map<string, vector<segment *> >::iterator it_type_5;
 
-  // Create an interval tree from the existing intervals
+  // Each chromosome's intervals are swept on their own, one per thread
+  vector<string> chroms;
   for(it_type_5 c = A.begin(); c != A.end(); c++) {
-    NT[c->first] 	= node(c->second);
-  }
-  int start, stop, N, j;
-  double coverage;
-  N 	= 0,j 	= 0;
-  int strand;
-  int o_st, o_sp;
-  vector<string> lineArray;
-  string chrom, prevchrom, line;
+    // each interval's bins start at its own start (minX)
+    for (int i = 0; i < c->second.size(); i++){
+      c->second[i]->coverage.reset(BINS, c->second[i]->minX, true);
+    }
+    chroms.push_back(c->first);
+  }
+  int line_number;
   vector<segment *> segments;
-  double center;
   vector<string> FILES;
 
   if (forward.empty() and reverse.empty()){
@@ -867,49 +1702,156 @@ vector<segment* > load::insert_bedgraph_to_segment_joint(map<string, vector<segm
   }else if (not forward.empty() and not reverse.empty()) {
     FILES 	= {forward, reverse};
   }
-  string FILE;
-  for (int i =0; i < FILES.size(); i++){
-    FILE=FILES[i];
-    ifstream FH(FILE);
-    if (FH){
-      prevchrom="";
-      while (getline(FH, line)){
-        lineArray       = string_split(line, '\t');
-        if (lineArray.size()==4){
-          chrom 		= lineArray[0];
-          start=stoi(lineArray[1]),stop=stoi(lineArray[2]), coverage = stod(lineArray[3]);
-          if (coverage > 0 and i == 0){
-            strand 	= 1;
-          }else if (coverage < 0 or i==1){
-            strand 	= -1;
-          }
-          center 	= (stop + start) /2.;
-          if (NT.find(chrom)!=NT.end()){
-            for (int center_2=start; center_2 < stop; center_2++){
-              vector<double> x(2);
-              x[0]=double(center_2), x[1] = abs(coverage);
-              NT[chrom].insert_coverage(x, strand);
-            }
-
-          }
-        } else { 
-          printf("\n***error in line: %s, not bedgraph formatted\n", line.c_str() );
-          segments.clear();
-          return segments;
-        }
+  int num_proc 	= omp_get_max_threads();
+  // A cache (see coverage_cache) is searched per interval instead of streamed
+  coverage_cache CC;
+  if (FILES.size()==1 and coverage_cache::is_cache(FILES[0])){
+    if (not CC.open(FILES[0])){
+      segments.clear();
+      return segments;
+    }
+    #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+    for (int t = 0; t < chroms.size(); t++) {
+      const vector<segment *> & I 	= A.find(chroms[t])->second;
+      int idx 	= CC.find(chroms[t]);
+      for (int i = 0; idx >= 0 and i < I.size(); i++){
+	segment * S 	= I[i];
+	for (int s = 0; s < 2; s++){
+	  const cov_run * R 	= CC.runs(idx, s);
+	  size_t n 	= CC.chrom(idx).count[s];
+	  for (size_t k = CC.first_run(idx, s, S->start+1); k < n and R[k].start < S->stop; k++){
+	    add_inside(S, coverage_run(R[k].start, R[k].stop, R[k].value), s==0 ? 1 : -1);
+	  }
+	}
       }
-      FH.close();
-    }else{
-      cout<<"could not open forward bedgraph file: "<<FILE<<endl;
+    }
+    FILES.clear();
+  }
+  // bigWig input: only the blocks overlapping this process's intervals are read
+  bigwig_reader BW[2];
+  int bigwig 	= open_bigwigs(FILES, BW);
+  if (bigwig < 0){
+    segments.clear();
+    return segments;
+  }
+  if (bigwig){
+    bool corrupt 	= false;
+    #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+    for (int t = 0; t < chroms.size(); t++){
+      const vector<segment *> & I 	= A.find(chroms[t])->second;
+      coverage_sweep sweep(I);
+      vector<bw_item> items;
+      for (int u = 0; u < FILES.size(); u++){
+	int c 	= BW[u].find(chroms[t]);
+	map<uint64_t, bw_block> wanted;	// offset -> block, so each is read once and in order
+	for (int i = 0; c >= 0 and i < I.size(); i++){
+	  vector<bw_block> B 	= BW[u].blocks(c, max(I[i]->start + 1, 0), max(I[i]->stop, 0));
+	  for (int b = 0; b < B.size(); b++){
+	    wanted[B[b].offset] 	= B[b];
+	  }
+	}
+	int strand 	= -1;
+	sweep.restart();
+	for (map<uint64_t, bw_block>::iterator w = wanted.begin(); w != wanted.end(); w++){
+	  if (not BW[u].read(w->second, items)){
+	    printf("corrupt bigWig block at byte %llu in %s\n", (unsigned long long)w->first, FILES[u].c_str());
+	    #pragma omp atomic write
+	    corrupt 	= true;
+	    break;
+	  }
+	  for (int k = 0; k < items.size(); k++){
+	    if (items[k].chrom != uint32_t(c)){
+	      continue;
+	    }
+	    if (items[k].value > 0 and u == 0){
+	      strand 	= 1;
+	    }else if (items[k].value < 0 or u==1){
+	      strand 	= -1;
+	    }
+	    sweep.add(coverage_run(items[k].start, items[k].end, fabs(items[k].value)), strand);
+	  }
+	}
+      }
+    }
+    if (corrupt){
+      segments.clear();
+      return segments;
+    }
+    FILES.clear();
+  }
+  // Parse the files in chunks on all threads (see load_bedgraphs_total) to
+  // find each chromosome's lines, then sweep them a chromosome per thread.
+  bedgraph_reader FH[2];
+  for (int i =0; i < FILES.size(); i++){
+    if (not FH[i].open(FILES[i])){
+      cout<<"could not open forward bedgraph file: "<<FILES[i]<<endl;
       segments.clear();
       return segments;
     }
   }
+  if (not FILES.empty()){
+    vector<bedgraph_chunk> K 	= scan_bedgraphs(FH, FILES.size(), "all");
+    int bad 	= first_bad_chunk(K, line_number);
+    if (bad >= 0){
+      printf("\n***error in line: %s, not bedgraph formatted\n", K[bad].bad_line.c_str() );
+      segments.clear();
+      return segments;
+    }
+    map<string, chrom_extent> G;
+    set<string> in_first;
+    set<pair<string, int> > unsorted;
+    merge_chunks(K, G, in_first, unsorted);
+    #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+    for (int t = 0; t < chroms.size(); t++){
+      map<string, chrom_extent>::iterator g 	= G.find(chroms[t]);
+      if (g==G.end()){
+	continue;
+      }
+      coverage_sweep sweep(A.find(chroms[t])->second);
+      bedgraph_reader R[2];
+      bg_record rec;
+      for (int i = 0; i < FILES.size(); i++){
+	R[i].attach(FH[i]);
+      }
+      // one sweep per file; a file whose lines are out of order is sorted first
+      for (int i = 0; i < FILES.size(); i++){
+	bool sorted 	= not unsorted.count(make_pair(chroms[t], i));
+	vector<pair<coverage_run, int> > runs;
+	int strand 	= -1;
+	sweep.restart();
+	for (int b = 0; b < g->second.blocks.size(); b++){
+	  const line_block & B 	= g->second.blocks[b];
+	  if (B.file != i){
+	    continue;
+	  }
+	  R[i].seek(B.begin, B.end);
+	  while (R[i].next(rec)){
+	    if (rec.coverage > 0 and i == 0){
+	      strand 	= 1;
+	    }else if (rec.coverage < 0 or i==1){
+	      strand 	= -1;
+	    }
+	    coverage_run x(rec.start, rec.stop, abs(rec.coverage));
+	    if (sorted){
+	      sweep.add(x, strand);
+	    }else{
+	      runs.push_back(make_pair(x, strand));
+	    }
+	  }
+	}
+	if (not sorted){
+	  stable_sort(runs.begin(), runs.end(), run_starts_before);
+	  for (size_t r = 0; r < runs.size(); r++){
+	    sweep.add(runs[r].first, runs[r].second);
+	  }
+	}
+      }
+    }
+  }
   //now we want to get all the intervals and make a vector<segment *> again...
   vector<segment *>NS;
-  typedef map<string, node>::iterator it_type_6;
-  for (it_type_6 c = NT.begin(); c!=NT.end(); c++){
-    c->second.retrieve_nodes(NS);
+  for(it_type_5 c = A.begin(); c != A.end(); c++) {
+    NS.insert(NS.end(), c->second.begin(), c->second.end());
   }
 
   return NS;
@@ -1010,17 +1952,29 @@ void load::write_out_bidirs(map<string , vector<vector<double> > > G, string out
   FHW<<P->get_header(1);
   int ID 	= 0;
   for (it_type c = G.begin(); c!=G.end(); c++){
-    vector<vector<double>> data_intervals 	=  bubble_sort_alg(c->second);
-    
-    for (int i = 0; i < data_intervals.size(); i++){
-      FHW<<c->first<<"\t"<<to_string(int(data_intervals[i][0]))<<"\t"<<to_string(int(data_intervals[i][1]))<<"\tME_"<<to_string(ID)<<"\t";
-      FHW<<to_string(data_intervals[i][2] )+"," + to_string(int(data_intervals[i][3] )) + "," + to_string(int(data_intervals[i][4]) )<<endl; 
-      ID++;
-    }
+    write_out_bidirs_chrom(FHW, c->first, c->second, ID);
   }
   FHW.close();
 }
 
+/**
+ * @brief Write one chromosome's bidirectional hits, sorted by start.
+ * @param FHW open prelim_bidir_hits file
+ * @param chrom chromosome name
+ * @param intervals start, stop, log10 p, forward and reverse coverage per hit
+ * @param ID next ME_ identifier (advanced past the hits written)
+ * @return (void)
+ */
+void load::write_out_bidirs_chrom(ofstream & FHW, string chrom, 
+				  vector<vector<double> > intervals, int & ID){
+  vector<vector<double>> data_intervals 	=  bubble_sort_alg(intervals);
+  for (int i = 0; i < data_intervals.size(); i++){
+    FHW<<chrom<<"\t"<<to_string(int(data_intervals[i][0]))<<"\t"<<to_string(int(data_intervals[i][1]))<<"\tME_"<<to_string(ID)<<"\t";
+    FHW<<to_string(data_intervals[i][2] )+"," + to_string(int(data_intervals[i][3] )) + "," + to_string(int(data_intervals[i][4]) )<<endl; 
+    ID++;
+  }
+}
+
 
 void load::write_out_models_from_free_mode(map<int, map<int, vector<simple_c_free_mode>  > > G, 
 	params * P, int job_ID,map<int, string> IDS, int noise, string & file_name){
@@ -1155,7 +2109,7 @@ void load::write_out_bidirectionals_ms_pen(vector<segment_fits*> fits, params *
  */
 void load::BIN(vector<segment*> segments, int BINS, double scale, bool erase){
 	for (int i = 0 ; i < segments.size() ; i ++){
-		if (segments[i]->forward.size() > 0 or segments[i]->reverse.size() > 0 ){
+		if (not segments[i]->coverage.empty){
 			segments[i]->bin(BINS, scale, erase);
 		}
 	}
@@ -10,10 +10,13 @@
 #ifndef load_H
 #define load_H
 
+#include <fstream>
 #include <map>
 #include <string>
 #include <vector>
 
+#include "bin_matrix.h"
+#include "coverage_bins.h"
 #include "read_in_parameters.h"
 
 using namespace std;
@@ -22,6 +25,49 @@ class simple_c_free_mode;
 
 class classifier; //forward declare
 
+/**
+ * @brief A run of equal coverage on one strand, i.e. one bedgraph line.
+ * Covers the bases start, start+1, ... < stop; each base has depth value.
+ */
+class coverage_run{
+public:
+	double start; //!< first base of the run
+	double stop;  //!< one past the last base
+	double value; //!< coverage (read depth) at every base in the run
+
+	coverage_run(double, double, double);
+};
+
+/**
+ * @brief Lines of one bedgraph file that were streamed into a segment.
+ * Kept so a segment can be read again if its first base turns out to be
+ * off the bin lattice it was streamed on (i.e. unsorted input), or so a
+ * chromosome can be loaded on its own (see load::index_bedgraphs).
+ */
+class line_block{
+public:
+	int file;	//!< index into FILES
+	size_t begin;	//!< byte offset of the first line
+	size_t end;	//!< byte offset one past the last line
+
+	line_block(int f, size_t b, size_t e){ file = f, begin = b, end = e; }
+};
+
+/**
+ * @brief Where one chromosome's coverage is in the input and how far it extends.
+ * Built by load::index_bedgraphs without keeping any coverage.
+ */
+class chrom_extent{
+public:
+	string chrom;	//!< chromosome name
+	double lo;		//!< first base covered (segment::minX once loaded)
+	double hi;		//!< last base covered (segment::maxX once loaded)
+	vector<line_block> blocks;	//!< its lines, in file order (empty for a cache)
+
+	chrom_extent(string, double, double);
+	double bytes(double) const;	// memory needed once loaded and scanned at a bin width
+};
+
 /**
  * @brief Primary data class which represents a genomic segment of data.
  * @author Joey Azofeifa
@@ -35,16 +81,11 @@ public:
 	double maxX;   //!< max coordinate, scaled
 	string strand; //!< strand information, unspecified = "."
 
-    /** 
-	 * @brief vectors of vectors where the inner vector is two doubles
-	 * Expected to be [ x y ] with x being a coordinate [0th item] and y [1st item] being a value (reads?)
-     */
-	vector< vector<double> > forward; //<! corresponds to strand == 1
-    /** 
-	 * @brief vectors of vectors where the inner vector is two doubles
-	 * Expected to be [ x y ] with x being a coordinate [0th item] and y [1st item] being a value (reads?)
-     */
-	vector< vector<double> > reverse; //<! corresponds to strand == -1
+	/**
+	 * @brief Coverage binned as it is read in (streaming), per strand.
+	 * Consumed (and cleared) by bin() which builds X from it.
+	 */
+	coverage_bins coverage;
 
 	int ID; //!< when are these used? (set to 0 in constructors)
 	int chrom_ID;  //!< when are these used? (set to 0 in constructors)
@@ -57,10 +98,15 @@ public:
 	/**
 	 * @brief This (X) is the smoothed representation of the data.
 	 * Vector[0] is coordinate (possibly scaled); [1] is forward (summed for bin)
-	 * [2] is reverse (summed for bin)
+	 * [2] is reverse (summed for bin).  Rows are contiguous and 64 byte aligned.
 	 */
-	double ** X;  //!< Smoothed data inner is [3] dimensions
+	bin_matrix X;  //!< Smoothed data, 3 x XN
 	double XN; //!< total number of bins
+	/**
+	 * @brief Running totals of X: C[0][i] is forward (X[1]) and C[1][i]
+	 * reverse (X[2]) summed over bins 0 ... i-1.  Built by index().
+	 */
+	bin_matrix C;  //!< 2 x (XN+1)
 	double SCALE;  //!< scaling factor
 
 	double N;	//!< Total sum of values 
@@ -68,6 +114,7 @@ public:
 	double rN;	//!< Sum of reverse values 
 
 	vector<vector<double> > bidirectional_bounds;
+	vector<vector<vector<double> > > bank_bounds;	//!< hits of each -templates entry
 	vector<segment *> bidirectional_data;
 	vector<int>  bidir_counts; //!< used for optimization of BIC?
 	vector<int> bidirectional_N;
@@ -86,6 +133,12 @@ public:
 	void bin(double, double, bool); // delta, scale, erase
 	// add2 appears to add a single data point (coord) to an interval
 	void add2(int, double, double); // strand, x, y 
+	// add_run adds a whole bedgraph line worth of bases at once
+	void add_run(int, double, double, double); // strand, start, stop, y
+	// index builds C once X is final; sum and find then answer window queries
+	void index();
+	double sum(int, int, int) const; // X row (1 or 2), bins j ... k-1
+	int find(double) const; // first bin with X[0] >= coordinate (XN if none)
 };
 
 /**
@@ -102,7 +155,6 @@ public:
 	vector<segment *> current;	//<! All intervals overlapping center
 
 	void retrieve_nodes(vector<segment * >&);
-	void insert_coverage(vector<double>, int);
 
 	// Constructors
 	node();	// empty constructor
@@ -145,12 +197,17 @@ namespace load{
 	vector<segment*> load_bedgraphs_total(string, 
 		string, string, int , double, string,map<string, int>&,map<int, string>&);
 
+	vector<chrom_extent> index_bedgraphs(string, string, string, string);
+	vector<segment*> load_chromosomes(string, string, string, 
+		const vector<chrom_extent>&, int, double);
+
 	void write_out_bidirs(map<string , vector<vector<double> > >, string, string, int ,params *, int);
+	void write_out_bidirs_chrom(ofstream &, string, vector<vector<double> >, int &);
 	vector<segment *> load_intervals_of_interest(string,map<int, string>&, params *, bool);
 
 	void collect_all_tmp_files(string , string, int, int );
 	vector<segment* > insert_bedgraph_to_segment_joint(map<string, vector<segment *> >  , 
-		string , string , string ,int);
+		string , string , string , int, int);
 
 	void write_out_models_from_free_mode(map<int, map<int, vector<simple_c_free_mode>  > >,
 		params *,int,map<int, string>, int, string &);
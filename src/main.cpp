@@ -2,8 +2,8 @@
  * @file main.cpp
  * @author Joey Azofeifa
  * @brief This is the primary executable file.  
- * It contains the mpi code, reading parameters, then forking to one of three functions:
- * \ref bidir_run, \ref model_run or \ref select_run -- which are all separate files. 
+ * It contains the mpi code, reading parameters, then forking to one of four functions:
+ * \ref bidir_run, \ref model_run, \ref select_run or \ref cache_run -- which are all separate files. 
  * @version 0.1
  * @date 2016-05-20
  * 
@@ -26,6 +26,7 @@
 #include "across_segments.h"
 #include "bidir_main.h"
 #include "bootstrap.h"
+#include "cache_main.h"
 #include "density_profiler.h"
 #include "error_stdo_logging.h"
 #include "load.h"
@@ -41,7 +42,7 @@ using namespace std;
 
 /**
  * @brief Program main.  
- * It contains the mpi code, reading parameters, then forking to one of three modules. 
+ * It contains the mpi code, reading parameters, then forking to one of four modules. 
  * @param argc
  * @param argv
  * @return 
@@ -82,6 +83,8 @@ int main(int argc, char* argv[]){
   }else if (P->select){
     // This one is commented out -- ie. this function does nothing.
     select_run(P, rank, nprocs, job_ID,LG);	
+  }else if (P->cache){
+    cache_run(P, rank, nprocs, job_ID,LG);
   }
   if (rank == 0){
     load::collect_all_tmp_files(P->p["-log_out"], P->p["-N"], nprocs, job_ID);
@@ -26,6 +26,8 @@
 #include <mpi.h>
 #include "omp.h"
 
+#include "em_arrays.h"
+#include "emg_batch.h"
 #include "load.h"
 #include "template_matching.h"
 
@@ -286,35 +288,58 @@ double EMG::EY2(double z, int s){
 	return pow(l,2)*pow(si,4) + pow(si, 2)*(2*l*s*(mu-z)+1 ) + pow(mu-z,2) - ((si*(l*pow(si,2) + s*(mu-z)))/R(l*si - s*((z-mu)/si) )); 
 }
 
+/**
+ * @brief EMG::pdf (and EMG::EY, EMG::EY2) at n bins on both strands in
+ * one vectorized pass each (see emg_batch.h); results go to bp, bey, bey2.
+ *
+ * @param x bin coordinates
+ * @param n number of bins
+ * @param stats also compute EY and EY2
+ * @param first bin of x to start at; bp[s][0] is then bin first
+ */
+void EMG::batch(const double * x, int n, bool stats, int first){
+	emg_params P;
+	P.mu = mu, P.si = si, P.l = l, P.w = w, P.pi = pi;
+	P.foot_print 	= foot_print;
+	lo 	= first, hi = first + n;
+	for (int s = 0; s < 2; s++){
+		bp[s].resize(n);
+		if (stats){
+			bey[s].resize(n), bey2[s].resize(n);
+		}
+		if (n > 0){
+			emg_batch(P, x + first, n, s==0 ? 1 : -1, bp[s].data(),
+				stats ? bey[s].data() : NULL, stats ? bey2[s].data() : NULL);
+		}
+	}
+}
+
 //===============================================================================
 //functions that help estimate uniform support bounds
 /**
  * @brief Get the nearest position. 
  *  This is a helper function for estimating support bounds. 
+ *  Bins are found by binary search (segment::find).
  * @param data 
  * @param center 
  * @param dist 
  * @return int 
  */
 int get_nearest_position(segment * data, double center, double dist){
-	int i;
-
+	int last 	= data->XN-1;
+	int i 		= data->find(center + dist); // first bin at or right of center+dist
 	if (dist < 0 ){
-		i=0;
-		while (i < (data->XN-1) and (data->X[0][i] -center) < dist){
-			i++;
-		}
-	}else{
-		i=data->XN-1;
-		while (i >0 and (data->X[0][i] - center) > dist){
-			i--;
-		}
+		return max(min(i, last), 0);
 	}
-	return i;
+	// last bin at or left of center+dist
+	if (i > last or data->X[0][i] > center + dist){
+		i--;
+	}
+	return max(min(i, last), 0);
 }
 /**
  * @brief Get the sum of segment between j and k.
- * 
+ *  Read off the segment's running totals (segment::index).
  * @param data 
  * @param j 
  * @param k 
@@ -322,11 +347,10 @@ int get_nearest_position(segment * data, double center, double dist){
  * @return double 
  */
 double get_sum(segment * data, int j, int k, int st){
-	double S 	= 0;
-	for (int i = j; i <k;i++){
-		S+=data->X[st][i];
+	if (j >= k){
+		return 0;
 	}
-	return S;
+	return data->sum(st, j, k);
 }
 /**
  * @brief 
@@ -395,6 +419,7 @@ void update_j_k( component * components,segment * data, int K, double N){
  * @param K 
  */
 void update_l(component * components, segment * data, int K){
+	const double * x 	= data->X[0], * f = data->X[1], * r = data->X[2];
 	for (int k 	= 0; k < K; k++){
 		//forward
 		double left_SUM=0, right_SUM=get_sum(data,components[k].forward.j ,components[k].forward.k,1);
@@ -409,9 +434,9 @@ void update_l(component * components, segment * data, int K){
 		int arg_l 	= components[k].forward.k;
 
 		for (int l = components[k].forward.j; l < components[k].forward.k; l++ ){
-			left_SUM+=data->X[1][l];
-			right_SUM-=data->X[1][l];
-			vl 		= 1.0/(data->X[0][l]-data->X[0][components[k].forward.j]);
+			left_SUM+=f[l];
+			right_SUM-=f[l];
+			vl 		= 1.0/(x[l]-x[components[k].forward.j]);
 			w 		= left_SUM/(N);
 			mod_ll 	= LOG(w*vl)*left_SUM + LOG(null_vl)*right_SUM ;
 			mod_BIC = -2*mod_ll + 5*LOG(N);
@@ -424,7 +449,7 @@ void update_l(component * components, segment * data, int K){
 			prev_prev=prev;
 			prev 	= current;			
 		}
-		components[k].forward.b 	= data->X[0][arg_l];
+		components[k].forward.b 	= x[arg_l];
 		//reverse
 		arg_l 	= components[k].reverse.j;
 		left_SUM=0, right_SUM=get_sum(data,components[k].reverse.j,components[k].reverse.k,2 );
@@ -433,9 +458,9 @@ void update_l(component * components, segment * data, int K){
 		null_BIC = -2*null_ll + LOG(N);
 		prev_prev=0, prev=0, current=0,BIC_best = 0;
 		for (int l = components[k].reverse.j; l < components[k].reverse.k; l++ ){
-			left_SUM+=data->X[2][l];
-			right_SUM-=data->X[2][l];
-			vl 		= 1.0/(data->X[0][components[k].reverse.k] - data->X[0][l]);
+			left_SUM+=r[l];
+			right_SUM-=r[l];
+			vl 		= 1.0/(x[components[k].reverse.k] - x[l]);
 			w 		= right_SUM/(N);
 			mod_ll 	= LOG(null_vl)*left_SUM + LOG(w*vl)*right_SUM ;
 			mod_BIC = -2*mod_ll + 5*LOG(N);
@@ -448,7 +473,7 @@ void update_l(component * components, segment * data, int K){
 			prev_prev=prev;
 			prev 	= current;
 		}
-		components[k].reverse.a 	= data->X[0][arg_l];
+		components[k].reverse.a 	= x[arg_l];
 	}
 }
 
@@ -588,24 +613,95 @@ void component::print(){
 		cout<<"NOISE: " << noise.w<<"," <<noise.pi<<endl;
 	}
 }
+/**
+ * @brief first bin right of c
+ */
+static int bin_after(segment * data, double c){
+	int i 	= data->find(c);
+	while (i < data->XN and data->X[0][i] <= c){
+		i++;
+	}
+	return i;
+}
+/**
+ * @brief The bins inside [a,b], where the density is not 0
+ * (empty if w is 0).
+ *
+ * @param data 
+ * @param from first bin (out)
+ * @param to one past the last bin (out)
+ */
+void UNI::bins(segment * data, int & from, int & to){
+	from = 0, to = 0;
+	if (w != 0 and a <= b){
+		from 	= data->find(a), to = bin_after(data, b);
+	}
+}
+/**
+ * @brief The bins where the density is not negligible:
+ * EMG_TAIL_SIGMA sigmas plus EMG_TAIL_DECAY / lambda (and the foot
+ * print) either side of mu.  All bins if the parameters went bad.
+ *
+ * @param data 
+ * @param from first bin (out)
+ * @param to one past the last bin (out)
+ */
+void EMG::bins(segment * data, int & from, int & to){
+	double reach 	= foot_print + EMG_TAIL_SIGMA*si + EMG_TAIL_DECAY/l;
+	from = 0, to = 0;
+	if (not isfinite(mu) or not isfinite(reach)){
+		to 	= data->XN;
+	}else if (w != 0){
+		from 	= data->find(mu - reach), to = bin_after(data, mu + reach);
+	}
+}
+/**
+ * @brief Find the bins where this component has mass (EMG::bins and
+ * UNI::bins) and batch its EMG over them.  Called before every E-step.
+ *
+ * @param data 
+ */
+void component::support(segment * data){
+	int XN 	= data->XN;
+	if (type==0){
+		lo = 0, hi = XN;
+		return;
+	}
+	int a, b;
+	bidir.bins(data, a, b);
+	bidir.batch(data->X[0], b - a, true, a);
+	lo = a < b ? a : XN, hi = a < b ? b : 0;
+	UNI * U[2] 	= {&forward, &reverse};
+	for (int u = 0; u < 2; u++){
+		U[u]->bins(data, a, b);
+		if (a < b){
+			lo 	= min(lo, a), hi = max(hi, b);
+		}
+	}
+	if (lo > hi){
+		lo = 0, hi = 0;
+	}
+}
 /**
  * @brief compute the density at x_i,s_i
  * 
  * @param x 
  * @param st 
+ * @param i bin of x (support() has filled bidir's densities)
  * @return double 
  */
-double component::evaluate(double x, int st){
+double component::evaluate(double x, int st, int i){
 	if (type ==0){ //this is the uniform noise component
 		return noise.pdf(x, st);
 	}
+	bool in 	= bidir.lo <= i and i < bidir.hi; // negligible outside
 	if (st==1){
-		bidir.ri_forward 	= bidir.pdf(x, st);
+		bidir.ri_forward 	= in ? bidir.bp[0][i - bidir.lo] : 0;
 		forward.ri_forward 	= forward.pdf(x, st);
 		reverse.ri_forward 	= reverse.pdf(x,st);
 		return bidir.ri_forward + forward.ri_forward + reverse.ri_forward;
 	}
-	bidir.ri_reverse 	= bidir.pdf(x, st);
+	bidir.ri_reverse 	= in ? bidir.bp[1][i - bidir.lo] : 0;
 	reverse.ri_reverse 	= reverse.pdf(x, st);
 	forward.ri_reverse 	= forward.pdf(x, st);
 	return bidir.ri_reverse + reverse.ri_reverse + forward.ri_reverse;
@@ -619,8 +715,9 @@ double component::evaluate(double x, int st){
  * @param y 
  * @param st 
  * @param normalize 
+ * @param i bin of x (support() has filled bidir's expectations)
  */
-void component::add_stats(double x, double y, int st, double normalize){
+void component::add_stats(double x, double y, int st, double normalize, int i){
 	if (type==0){//noise component
 		if (st==1){
 			noise.r_forward+=(y*noise.ri_forward/normalize);
@@ -653,8 +750,8 @@ void component::add_stats(double x, double y, int st, double normalize){
 		}
 		//now adding all the conditional expectations for the convolution
 		if (vl > 0 and y > 0){
-			double current_EY 	= bidir.EY(x, st);
-			double current_EY2 	= bidir.EY2(x, st);
+			double current_EY 	= bidir.bey[st==1 ? 0 : 1][i - bidir.lo];
+			double current_EY2 	= bidir.bey2[st==1 ? 0 : 1][i - bidir.lo];
 			double current_EX 	= x-(st*current_EY)-bidir.foot_print*st;
 			//	self.C+=max( ((z-self.mu) -E_Y) *r,0)
 			// 	self.C+=max((-(z-self.mu) -E_Y)   *r ,0)
@@ -845,6 +942,9 @@ classifier::classifier(int k, double ct, int mi, double nm,
 	ALPHA_2=alpha_2, ALPHA_3=alpha_3;
 
 	move_l = true;
+	tiles 	= false;
+	racing 	= NULL;
+	warm 	= NULL;
 }
 /**
  * @brief Construct a new classifier::classifier object
@@ -881,6 +981,9 @@ classifier::classifier(int k, double ct, int mi, double nm,
 	ALPHA_0=alpha_0, BETA_0=beta_0, ALPHA_1=alpha_1, BETA_1=beta_1;
 	ALPHA_2=alpha_2, ALPHA_3=alpha_3;
 	move_l 	= MOVE;
+	tiles 	= false;
+	racing 	= NULL;
+	warm 	= NULL;
 }
 /**
  * @brief Construct a new classifier::classifier object
@@ -916,25 +1019,170 @@ classifier::classifier(double ct, int mi, double nm,
 	ALPHA_0=alpha_0, BETA_0=beta_0, ALPHA_1=alpha_1, BETA_1=beta_1;
 	ALPHA_2=alpha_2, ALPHA_3=alpha_3;
 	init_parameters 		= IP;
+	tiles 					= false;
+	racing 					= NULL;
+	warm 					= NULL;
 }
 
-classifier::classifier(){}; 
+classifier::classifier(){
+	tiles 	= false;
+	racing 	= NULL;
+	warm 	= NULL;
+}; 
 
 /**
- * @brief This is the core EM algorithm.
- * 
+ * @brief Construct a new race object
+ *
+ * @param a aggressiveness: a restart is abandoned when its log likelihood
+ * plus 1/a times the most it can still gain is short of the leader's
+ * @param n restarts
+ */
+race::race(double a, int n){
+	aggressiveness 	= a;
+	at.assign(n, nINF);
+	abandoned 		= 0;
+}
+
+/**
+ * @brief Restart r is now at log likelihood ll (nINF once it has failed:
+ * a fit on its way to an EXIT can pass the others before it collapses).
+ * @param r 
+ * @param ll 
+ */
+void race::post(int r, double ll){
+	#pragma omp critical(race)
+	{
+		at[r] 	= ll;
+	}
+}
+
+/**
+ * @brief Should a restart at log likelihood ll, expecting at most gain
+ * more, be abandoned?  Counts it if so.
+ * @param ll 
+ * @param gain 
+ * @return true if it can't catch the leader
+ */
+bool race::behind(double ll, double gain){
+	bool out;
+	#pragma omp critical(race)
+	{
+		double lead 	= *max_element(at.begin(), at.end());
+		out 	= ll + gain/aggressiveness < lead;
+		abandoned+=out;
+	}
+	return out;
+}
+
+/**
+ * @brief Where a fit explains the coverage worst: the center of the
+ * WARM_WINDOW wide stretch with the most reads above what the K
+ * components (and the noise, if add) predict there.
+ *
+ * @param components 
+ * @param K 
+ * @param add 
+ * @param data 
+ * @return double the position (x)
+ */
+static double largest_residual(component * components, int K, int add, segment * data){
+	int XN 	= data->XN;
+	const double * x 	= data->X[0], * f = data->X[1], * r = data->X[2];
+	double N 	= 0;
+	for (int i = 0; i < XN; i++){
+		N+=f[i]+r[i];
+	}
+	double delta 	= XN > 1 ? (x[XN-1] - x[0]) / (XN-1) : 1; //bin width
+	vector<double> res(XN);
+	for (int i = 0; i < XN; i++){
+		double p 	= 0;
+		for (int s = -1; s <= 1; s+=2){
+			for (int k = 0; k < K; k++){
+				p+=components[k].bidir.pdf(x[i], s) + components[k].forward.pdf(x[i], s)
+					+ components[k].reverse.pdf(x[i], s);
+			}
+			if (add){
+				p+=components[K].noise.pdf(x[i], s);
+			}
+		}
+		res[i] 	= f[i] + r[i] - N*delta*p;
+	}
+	double best = nINF, at = XN ? x[0] : 0, sum = 0;
+	for (int i = 0, a = 0, b = 0; i < XN; i++){ //sum over bins [a, b) within WARM_WINDOW/2 of bin i
+		while (b < XN and x[b] <= x[i] + WARM_WINDOW/2){
+			sum+=res[b++];
+		}
+		while (x[a] < x[i] - WARM_WINDOW/2){
+			sum-=res[a++];
+		}
+		if (sum > best){
+			best 	= sum, at = x[i];
+		}
+	}
+	return at;
+}
+
+/**
+ * @brief Copy the parameters of the K components (and the noise, if
+ * add) into E, with the bins each part reaches.
+ *
+ * @param E 
+ * @param components 
+ * @param K 
+ * @param add 
+ * @param data 
+ */
+static void to_arrays(em_arrays & E, component * components, int K, int add, segment * data){
+	E.resize(K);
+	for (int k = 0; k < K; k++){
+		EMG & B 	= components[k].bidir;
+		E.mu[k] = B.mu, E.si[k] = B.si, E.l[k] = B.l, E.w[k] = B.w, E.pi[k] = B.pi;
+		E.foot_print[k] 	= B.foot_print;
+		B.bins(data, E.lo[k], E.hi[k]);
+		UNI * U[2] 	= {&components[k].forward, &components[k].reverse};
+		for (int u = 0; u < 2; u++){
+			U[u]->bins(data, E.u_lo[2*k+u], E.u_hi[2*k+u]);
+			E.u_f[2*k+u] 	= U[u]->pdf(U[u]->a, 1);
+			E.u_r[2*k+u] 	= U[u]->pdf(U[u]->a, -1);
+		}
+	}
+	E.noise_f = 0, E.noise_r = 0;
+	if (add){
+		E.noise_f 	= components[K].noise.pdf(0, 1);
+		E.noise_r 	= components[K].noise.pdf(0, -1);
+	}
+}
+/**
+ * @brief Hand the sufficient statistics of an em_arrays E-step to the
+ * components, as component::add_stats would have left them.
+ *
+ * @param E 
+ * @param components 
+ * @param K 
+ * @param add 
+ */
+static void from_arrays(const em_arrays & E, component * components, int K, int add){
+	for (int k = 0; k < K; k++){
+		EMG & B 	= components[k].bidir;
+		B.r_forward = E.r_f[k], B.r_reverse = E.r_r[k];
+		B.ey = E.ey[k], B.ex = E.ex[k], B.ex2 = E.ex2[k], B.C = E.C[k];
+		components[k].forward.r_forward 	= E.u_rf[2*k], components[k].forward.r_reverse = E.u_rr[2*k];
+		components[k].reverse.r_forward 	= E.u_rf[2*k+1], components[k].reverse.r_reverse = E.u_rr[2*k+1];
+	}
+	if (add){
+		components[K].noise.r_forward 	= E.noise_rf;
+		components[K].noise.r_reverse 	= E.noise_rr;
+	}
+}
+
+/**
+ * @brief Set up the EM of fit2: seed the components and the noise.
  * @param data 
  * @param mu_seeds 
  * @param topology 
- * @param elon_move 
- * @return int 
+ * @return false if there is nothing to iterate (K=0, fit directly)
  */
-int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
-	 int elon_move ){
-
-	//printf("topology: %d elon_move %d K %d \n", topology, elon_move, K);
-	//  printf("K %d \n", K);
-	//=========================================================================
+bool classifier::em_init(segment * data, vector<double> mu_seeds, int topology){
 	//compute just a uniform model...no need for the EM
 	if (K == 0){
 		ll 			= 0;
@@ -959,7 +1207,7 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
     // Sets the components part of the classifier to a new component, but this is an array?
 		components 	= new component[1];
 	  // printf("\t l: %9.6f pos: %9.6f neg: %9.6f pi: %9.6f ll: %9.6f \n", l, pos, neg, pi, ll);
-		return 1;
+		return false;
 	}
 	// These are the seeds for the initial location.
 	random_device rd;
@@ -967,6 +1215,20 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 	
 	int add 	= noise_max>0;
 	components 	= new component[K+add];
+	if (warm != NULL){ //warm start (-warm_K): the K-1 fit, and one more component where it falls short
+		for (int k = 0; k < K-1; k++){
+			components[k] 	= warm->components[k];
+			components[k].bidir.w*=double(K-1)/K;
+			components[k].forward.w*=double(K-1)/K, components[k].reverse.w*=double(K-1)/K;
+		}
+		double mu 	= largest_residual(warm->components, K-1, add, data);
+		if (r_mu > 0){
+			normal_distribution<double> dist_r_mu(mu, r_mu);
+			mu 		= dist_r_mu(mt);
+		}
+		components[K-1].initialize_bounds(mu, 
+			data, K, data->SCALE , 0., topology,foot_print, data->maxX, data->maxX);
+	}
 	//===========================================================================
 	//initialize(1) components with user defined hyperparameters
 	for (int k = 0; k < K; k++){
@@ -978,7 +1240,7 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 	int i 	= 0;
 	double mu;
 	double mus[K];
-	for (int k = 0; k < K; k++){
+	for (int k = 0; k < K and warm == NULL; k++){
 		if (mu_seeds.size()>0  ){
 			i 	= sample_centers(mu_seeds ,  p);
 			mu 	= mu_seeds[i];
@@ -997,7 +1259,7 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 		}
 	}
 	sort_vector(mus, K);
-	for (int k = 0; k < K;k++){ //random seeding, initialize(3) other parameters
+	for (int k = 0; k < K and warm == NULL;k++){ //random seeding, initialize(3) other parameters
 		components[k].initialize_bounds(mus[k], 
 			data, K, data->SCALE , 0., topology,foot_print, data->maxX, data->maxX);
 		
@@ -1016,100 +1278,253 @@ int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
 		}
 	}
 	// I think this is the noise component ...
-	if (add){
+	if (add and warm != NULL){
+		components[K] 	= warm->components[K-1];
+	}else if (add){
 		components[K].initialize_bounds(0., data, 0., 0. , noise_max, pi, foot_print, data->minX, data->maxX);
 	}
 
+
 	//===========================================================================
-	int t 			= 0; //EM loop ticker
-	double prevll 	= nINF; //previous iterations log likelihood
-	converged 		= false; //has the EM converged?
-	int u 			= 0; //elongation movement ticker
-	double norm_forward, norm_reverse,N; //helper variables
+	t 			= 0; //EM loop ticker
+	prevll 		= nINF; //previous iterations log likelihood
+	converged 	= false; //has the EM converged?
+	u 			= 0; //elongation movement ticker
+	abandoned 	= false; //dropped from a race?
+	race_ll[0] 	= nINF, race_ll[1] = nINF;
+	return true;
+}
+
+/**
+ * @brief Start an EM iteration: clear the sufficient statistics.
+ * @return false if a component has exited (the fit failed, ll=nINF)
+ */
+bool classifier::em_reset(){
+	int add 	= noise_max>0;
+	for (int k=0; k < K+add; k++){
+		// components[k].print();
+		components[k].reset();
+		if (components[k].EXIT){
+			converged=false, ll=nINF;
+			if (racing){
+				racing->post(lane, ll);
+			}
+			return false;
+		}
+	       
+	}
+	return true;
+}
+
+/**
+ * @brief Finish an EM iteration once the E-step has filled in ll and the
+ * sufficient statistics.
+ * @param data 
+ * @param elon_move 
+ * @return 0 if the fit failed (ll=nINF)
+ */
+int classifier::em_update(segment * data, int elon_move){
+	int add 	= noise_max>0;
+	//======================================================
+	//M-step, Equation 10 in Azofeifa 2017, Theta_k^(t+1)
+	double N=0; //get normalizing constant
+	for (int k = 0; k < K+add; k++){
+		N+=(components[k].get_all_repo());
+	}
+	
+	for (int k = 0; k < K+add; k++){
+		components[k].update_parameters(N, K);
+	}
+	
+	if (abs(ll-prevll)<convergence_threshold){
+		converged=true;
+	}
+	if (not isfinite(ll)){
+		ll 	= nINF;
+		if (racing){
+			racing->post(lane, ll);
+		}
+		return 0;	
+	}
+	//======================================================
+	//should we try to move the uniform component? e.g. change L
+	if (u > 200 ){
+		sort_components(components, K);
+		//check_mu_positions(components, K);
+		if (elon_move){
+			update_j_k(components,data, K, N);
+			update_l(components,  data, K);
+		}
+		u 	= 0;
+	}
+	//======================================================
+	//racing the other restarts (-race): while the gain between checks
+	//keeps shrinking, the rest of the EM can add at most the last gain per
+	//check still to come; give up if even that can't reach the leader
+	if (racing){
+		racing->post(lane, ll);
+		if (t > 0 and t%RACE_EVERY == 0 and not converged){
+			double d1 	= ll - race_ll[1], d0 = race_ll[1] - race_ll[0];
+			if (isfinite(race_ll[0]) and d1 > 0 and d0 > d1){
+				abandoned 	= racing->behind(ll, d1*(max_iterations - t)/RACE_EVERY);
+			}
+			race_ll[0] 	= race_ll[1], race_ll[1] = ll;
+		}
+	}
+
+	u++;
+	t++;
+	prevll=ll;
+	return 1;
+}
+
+/**
+ * @brief This is the core EM algorithm.
+ * 
+ * @param data 
+ * @param mu_seeds 
+ * @param topology 
+ * @param elon_move 
+ * @return int 
+ */
+int classifier::fit2(segment * data, vector<double> mu_seeds, int topology,
+	 int elon_move ){
+
+	//printf("topology: %d elon_move %d K %d \n", topology, elon_move, K);
+	//  printf("K %d \n", K);
+	if (not em_init(data, mu_seeds, topology)){
+		return 1;
+	}
+	int add 	= noise_max>0;
+	double norm_forward, norm_reverse; //helper variables
+	vector<int> order(K+add), active; //components by first bin; those covering the current bin
+	em_arrays E; //the components as arrays, with tiles
 	//printf("------------------------------------------\n");
-	while (t < max_iterations && not converged){
+	while (t < max_iterations && not converged && not abandoned){
 		//======================================================
 		//reset old sufficient statistics
-		for (int k=0; k < K+add; k++){
-			// components[k].print();
-			components[k].reset();
-			if (components[k].EXIT){
-				converged=false, ll=nINF;
-				return 0;
-			}
-		       
+		if (not em_reset()){
+			return 0;
 		}
 		
 		//======================================================
 		//E-step, grab all the stats and responsibilities
 		ll 	= 0;
-		// i -> |D| (Azofeifa 2017 pseudocode) 
-		for (int i =0; i < data->XN;i++){
-			norm_forward=0;
-			norm_reverse=0;
-			
-			// Equation 7 in Azofeifa 2017: calculate r_i^k
-			for (int k=0; k < K+add; k++){ //computing the responsibility terms
-				if (data->X[1][i]){//if there is actually data point here...
-					norm_forward+=components[k].evaluate(data->X[0][i],1);
+		const double * x 	= data->X[0], * f = data->X[1], * r = data->X[2];
+		if (tiles){ //all of it on structure-of-arrays tiles
+			to_arrays(E, components, K, add, data);
+			ll 	= E.estep(x, f, r, data->XN);
+			from_arrays(E, components, K, add);
+		}else{
+			for (int k=0; k < K+add; k++){ //where each has mass; bidir densities and expectations there
+				components[k].support(data);
+				order[k] 	= k;
+			}
+			sort(order.begin(), order.end(), [this](int j, int k){ return components[j].lo < components[k].lo; });
+			//sweep the bins, keeping the components whose support covers bin i (in k order)
+			active.clear();
+			int next 	= 0;
+			for (int i =0; i < data->XN;i++){
+				while (next < K+add and components[order[next]].lo <= i){
+					int k 	= order[next++];
+					if (i < components[k].hi){
+						active.insert(upper_bound(active.begin(), active.end(), k), k);
+					}
 				}
-				if (data->X[2][i]){//if there is actually data point here...
-					norm_reverse+=components[k].evaluate(data->X[0][i],-1);
+				for (int a = 0; a < active.size(); a++){
+					if (components[active[a]].hi <= i){
+						active.erase(active.begin() + a--);
+					}
 				}
-			}
-			if (norm_forward > 0){
-				ll+=LOG(norm_forward)*data->X[1][i];
-			}
-			if (norm_reverse > 0){
-				ll+=LOG(norm_reverse)*data->X[2][i];
-			}
+				if (not f[i] and not r[i]){
+					continue;
+				}
+				norm_forward=0;
+				norm_reverse=0;
 			
-			//now we need to add the sufficient statistics, need to compute expectations
-			// Equation 9 in Azofeifa 2017
-			for (int k=0; k < K+add; k++){
-				if (norm_forward){
-					components[k].add_stats(data->X[0][i], data->X[1][i], 1, norm_forward);
+				// Equation 7 in Azofeifa 2017: calculate r_i^k
+				for (int a=0; a < active.size(); a++){ //computing the responsibility terms
+					int k 	= active[a];
+					if (f[i]){//if there is actually data point here...
+						norm_forward+=components[k].evaluate(x[i],1,i);
+					}
+					if (r[i]){//if there is actually data point here...
+						norm_reverse+=components[k].evaluate(x[i],-1,i);
+					}
+				}
+				if (norm_forward > 0){
+					ll+=LOG(norm_forward)*f[i];
 				}
-				if (norm_reverse){
-					components[k].add_stats(data->X[0][i], data->X[2][i], -1, norm_reverse);
+				if (norm_reverse > 0){
+					ll+=LOG(norm_reverse)*r[i];
+				}
+			
+				//now we need to add the sufficient statistics, need to compute expectations
+				// Equation 9 in Azofeifa 2017
+				for (int a=0; a < active.size(); a++){
+					int k 	= active[a];
+					if (norm_forward){
+						components[k].add_stats(x[i], f[i], 1, norm_forward, i);
+					}
+					if (norm_reverse){
+						components[k].add_stats(x[i], r[i], -1, norm_reverse, i);
+					}
 				}
 			}
 		}
 
-		//======================================================
-		//M-step, Equation 10 in Azofeifa 2017, Theta_k^(t+1)
-		N=0; //get normalizing constant
-		for (int k = 0; k < K+add; k++){
-			N+=(components[k].get_all_repo());
+		if (not em_update(data, elon_move)){
+			return 0;
 		}
-		
-		for (int k = 0; k < K+add; k++){
-			components[k].update_parameters(N, K);
-		}
-		
-		if (abs(ll-prevll)<convergence_threshold){
-			converged=true;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief fit2 with the E-step on tiles for several restarts of the same
+ * segment at once: every EM iteration makes one pass over the bins for
+ * all of them (estep_all).  A restart drops out of the batch as soon as
+ * it converges, runs out of iterations, fails or is abandoned (-race);
+ * the rest carry on.
+ * @param fits the restarts (same K)
+ * @param data 
+ * @param mu_seeds 
+ * @param topology 
+ * @param elon_move 
+ */
+void fit2_batch(vector<classifier *> & fits, segment * data, vector<double> mu_seeds, int topology,
+	int elon_move){
+	vector<int> live; //restarts still iterating
+	for (int j = 0; j < fits.size(); j++){
+		if (fits[j]->em_init(data, mu_seeds, topology)){
+			live.push_back(j);
 		}
-		if (not isfinite(ll)){
-			ll 	= nINF;
-			return 0;	
+	}
+	vector<em_arrays> E(fits.size());
+	vector<em_arrays *> pass;
+	vector<double> ll;
+	const double * x 	= data->X[0], * f = data->X[1], * r = data->X[2];
+	while (live.size()){
+		pass.clear();
+		for (int a = 0; a < live.size(); a++){
+			classifier * c 	= fits[live[a]];
+			if (c->t >= c->max_iterations or c->converged or c->abandoned or not c->em_reset()){
+				live.erase(live.begin() + a--);
+				continue;
+			}
+			to_arrays(E[live[a]], c->components, c->K, c->noise_max>0, data);
+			pass.push_back(&E[live[a]]);
 		}
-		//======================================================
-		//should we try to move the uniform component? e.g. change L
-		if (u > 200 ){
-			sort_components(components, K);
-			//check_mu_positions(components, K);
-			if (elon_move){
-				update_j_k(components,data, K, N);
-				update_l(components,  data, K);
+		estep_all(pass, x, f, r, data->XN, ll);
+		for (int a = 0; a < live.size(); a++){
+			classifier * c 	= fits[live[a]];
+			from_arrays(E[live[a]], c->components, c->K, c->noise_max>0);
+			c->ll 	= ll[a];
+			if (not c->em_update(data, elon_move)){
+				live.erase(live.begin() + a);
+				ll.erase(ll.begin() + a--);
 			}
-			u 	= 0;
 		}
-
-		u++;
-		t++;
-		prevll=ll;
 	}
-
-	return 1;
 }
@@ -12,6 +12,7 @@
 #define model_H
 
 #include <string>
+#include <vector>
 
 #include "load.h"
 
@@ -43,6 +44,7 @@ public:
 
 	// Functions
 	double pdf(double,int);	
+	void bins(segment *, int &, int &);
 	string print();
 
 };
@@ -59,6 +61,11 @@ double sum(double * , int );
  */
 double LOG(double );
 
+// fit2's E-step drops EMG mass beyond foot_print + EMG_TAIL_SIGMA*si +
+// EMG_TAIL_DECAY/l of mu (relative density below ~1e-11 there)
+#define EMG_TAIL_SIGMA 8.
+#define EMG_TAIL_DECAY 25.
+
 /**
  * @brief Class for a single instance of the model.  Contains mostly 
  * the EMG but also l from the Uniform. 
@@ -76,6 +83,9 @@ public:
 	double foot_print;
 	bool move_fp;
 	double prev_mu;
+	// pdf, EY and EY2 at bins [lo, hi) from batch(); [0] + strand, [1] - strand
+	vector<double> bp[2], bey[2], bey2[2];
+	int lo, hi;
 
 	// Constructors
 	EMG();
@@ -84,6 +94,8 @@ public:
 	double pdf(double,int);
 	double EY(double ,int);
 	double EY2(double ,int);
+	void batch(const double *, int, bool, int lo=0);
+	void bins(segment *, int &, int &);
 	string print();
 };
 
@@ -149,12 +161,15 @@ public:
 
 	double w_thresh=0;
 
+	int lo, hi; // bins [lo, hi) where any part has mass (see support())
+
 	// Constructor
 	component();
 	// Functions
 	void initialize_bounds(double,  segment *, int , double , double, double, double, double, double);
-	double evaluate(double, int);
-	void add_stats(double, double , int, double);
+	void support(segment *);
+	double evaluate(double, int, int);
+	void add_stats(double, double , int, double, int);
 	void update_parameters(double,int);
 	void set_priors(double,double,double,double,double,double,double, int);
 	double get_all_repo();
@@ -172,6 +187,28 @@ public:
 
 };
 
+#define RACE_EVERY 100 //EM iterations between a restart's race checks
+#define WARM_WINDOW 5. //width (x) of the stretches searched for the largest residual (-warm_K)
+
+/**
+ * @brief The restarts of one model (segment, K) racing each other
+ * (-race): where each of them is, and how many have been dropped for
+ * trailing the leader.
+ */
+class race{
+public:
+	double aggressiveness; //higher abandons trailing restarts sooner
+	vector<double> at; //log likelihood of each restart, nINF if it failed
+	int abandoned; //restarts dropped from the race
+
+	// Constructor
+	race(double, int);
+
+	// Functions
+	void post(int, double);
+	bool behind(double, double);
+};
+
 /**
  * @brief Wrapper class around the EM
  * 
@@ -198,6 +235,14 @@ public:
 	bool converged;
 	double r_mu;
 	bool move_l;
+	bool tiles; //E-step on structure-of-arrays tiles (em_arrays.h, -em_tiles)
+	int t, u; //EM loop ticker, elongation movement ticker
+	double prevll; //previous iterations log likelihood
+	race * racing; //the other restarts of this model, NULL unless -race
+	int lane; //this restart's place in the race
+	bool abandoned; //dropped from the race
+	double race_ll[2]; //log likelihood at the last two race checks
+	classifier * warm; //best fit with K-1 components to start from (-warm_K), or NULL
 	double ALPHA_0, BETA_0, ALPHA_1, BETA_1, ALPHA_2, ALPHA_3;
 	vector<vector<double>> init_parameters;
 
@@ -213,6 +258,10 @@ public:
 
 	// Functions
 	int fit2(segment *,vector<double>, int, int);
+	// fit2 in parts, so that fit2_batch can run the E-steps of restarts together
+	bool em_init(segment *, vector<double>, int);
+	bool em_reset();
+	int em_update(segment *, int);
 
     /* Deprecated:  These appear undefined.	
 	int fit(segment *,vector<double>);
@@ -223,6 +272,8 @@ public:
 	*/
 };
 
+void fit2_batch(vector<classifier *> &, segment *, vector<double>, int, int);	// restarts sharing passes over the bins
+
 
 
 #endif
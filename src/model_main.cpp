@@ -64,7 +64,7 @@ int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_
 	//(2a) load bedgraph files and insert them into intervals of interest (interval tree...)
 	LG->write("inserting bedgraph data.................................",verbose);
 	vector<segment*> integrated_segments= load::insert_bedgraph_to_segment_joint(GG, 
-		forward_bed_graph_file, reverse_bed_graph_file, joint_bed_graph_file, rank);
+		forward_bed_graph_file, reverse_bed_graph_file, joint_bed_graph_file, stod(P->p["-br"]), rank);
 	//(2b) for each segment we are going to bin and scale and center, numerical stability
 	LG->write("done\n",verbose);
 	LG->write("binning, centering, scaling.............................",verbose);
@@ -79,7 +79,12 @@ int model_run(params * P, int rank, int nprocs, double density, int job_ID, Log_
 	SC.mean = 0.78, SC.std = 0.08; //this dependent on -w 0.9 !!!
 	SC.set_2(stod(P->p["-bct"]));
 	
-	run_global_template_matching(integrated_segments, out_file_dir, P, SC);	
+	score_writer * scores 	= P->p["-scores"].empty() ? NULL : new score_writer(P->p["-scores"]);
+	run_global_template_matching(integrated_segments, out_file_dir, P, SC, scores, NULL, NULL);	
+	if (scores != NULL and not scores->close()){
+		printf("couldn't write all scores to %s\n", P->p["-scores"].c_str());
+	}
+	delete scores;
 
 	LG->write("done\n",verbose);
 	//=======================================================================================
@@ -54,24 +54,25 @@ void NLR::init(segment * data, double MU , int K, double foot_print,
 
 }
 
-double NLR::pdf(double x){
-	return bidir.pdf(x,1) + bidir.pdf(x,-1) + forward.pdf(x,1) + forward.pdf(x,-1) + reverse.pdf(x,1) + reverse.pdf(x,-1);
+// i is x's bin: bidir's densities and expectations come from EMG::batch()
+double NLR::pdf(double x, int i){
+	return bidir.bp[0][i] + bidir.bp[1][i] + forward.pdf(x,1) + forward.pdf(x,-1) + reverse.pdf(x,1) + reverse.pdf(x,-1);
 }
 
-double NLR::addSS(double x, double y, double norm){
+double NLR::addSS(double x, double y, double norm, int i){
 	double re, rf,rr, epi, ex, ey, ey2;
-	re 	= (bidir.pdf(x,1) + bidir.pdf(x,-1))/norm;
+	re 	= (bidir.bp[0][i] + bidir.bp[1][i])/norm;
 	rf 	= (forward.pdf(x,1) + forward.pdf(x,-1))/norm;
 	rr 	= (reverse.pdf(x,1) + reverse.pdf(x,-1))/norm;
 	WE+=re*y;
 	WF+=rf*y;
 	WR+=rr*y;
 
-	epi 	= (bidir.pdf(x,1)  ) / ((bidir.pdf(x,1) )+ (bidir.pdf(x,-1) ) );
+	epi 	= (bidir.bp[0][i]  ) / ((bidir.bp[0][i] )+ (bidir.bp[1][i] ) );
 
-	ey 		= max(epi*bidir.EY(x,1)+(1.-epi)*bidir.EY(x,-1),0.);
+	ey 		= max(epi*bidir.bey[0][i]+(1.-epi)*bidir.bey[1][i],0.);
 
-	ey2 	= epi*bidir.EY2(x,1)+(1.-epi)*bidir.EY2(x,-1);
+	ey2 	= epi*bidir.bey2[0][i]+(1.-epi)*bidir.bey2[1][i];
 	ex 		= (x-(ey*epi)  + (ey *(1.-epi)	));
 	
 	ex 		+= (bidir.foot_print*(1-epi) -bidir.foot_print*epi  );
@@ -156,15 +157,18 @@ double classifier_single::fit(segment * data,double foot_print){
 			components[k].resetSS();
 		}
 		//e-step
+		for (int k = 0; k < K; k++){
+			components[k].bidir.batch(data->X[0], data->XN, true);
+		}
 		for (int i = 0; i < data->XN; i++){
 			x=data->X[0][i],y=data->X[1][i];
 			norm 	= 0;
 			for (int k = 0; k < K;k++){
-				norm+=components[k].pdf(x);
+				norm+=components[k].pdf(x, i);
 			}
 			ll+=log(norm)*y;
 			for (int k = 0; k < K; k++){
-				NNN+=components[k].addSS(x,y, norm);
+				NNN+=components[k].addSS(x,y, norm, i);
 			}
 		}
 		//m-step
@@ -25,8 +25,8 @@ public:
 	NLR();
 	void init( segment *, double, int, double,
 	 double, double, double, double, double);
-	double addSS(double, double, double);
-	double pdf(double );
+	double addSS(double, double, double, int);
+	double pdf(double, int);
 	double get_all();
 	void resetSS();
 	void set_new_parameters(double);
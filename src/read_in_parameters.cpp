@@ -27,6 +27,7 @@
 #include <string>
 #include <vector>
 
+#include "score_writer.h"
 #include "split.h"
 
 using namespace std;
@@ -68,6 +69,15 @@ params::params(){
   p["-mi"] 		= "2000";
   p["-r_mu"] 		= "0";
   p["-scores"] 	= "";
+  p["-stream"] 	= "0";
+  p["-mem"] 		= "2048";
+  p["-coarse"] 	= "0";
+  p["-templates"] = "";
+  p["-save_scan"] = "0";
+  p["-rethreshold"] = "";
+  p["-em_tiles"] 	= "0";
+  p["-race"] 		= "0";
+  p["-warm_K"] 	= "0";
   //================================================
   //Hyper parameters	
   p["-ALPHA_0"] = "1";
@@ -90,6 +100,7 @@ params::params(){
   bidir 			= 0;
   model 			= 0;
   select 			= 0;
+  cache 			= 0;
   CONFIG 			= 0;
 }
 /**
@@ -194,7 +205,12 @@ vector<string> params::validate_parameters(){
 	}else if(not is_path(p["-o"])){
 		errors.push_back("User specified output path, " +  p["-o"] +", but does not exist (-o)" );
 	}
-	if (!p["-ij"].empty() and (!p["-i"].empty() or !p["-j"].empty() )  ){
+	if (bidir and !p["-rethreshold"].empty()){
+		// the input is that of the saved scan
+		if (not is_path(p["-rethreshold"])){
+			errors.push_back("User specified a saved scan, " +  p["-rethreshold"] +", but does not exist (-rethreshold)" );
+		}
+	}else if (!p["-ij"].empty() and (!p["-i"].empty() or !p["-j"].empty() )  ){
 		errors.push_back("User specified both -ij and (-i or -j)");
 	}
 	else if (p["-ij"].empty()){
@@ -224,9 +240,50 @@ vector<string> params::validate_parameters(){
 	if (!p["-tss"].empty() and not is_path(p["-tss"])){
 		errors.push_back("User specified a file for tss bidir filter training, " +  p["-tss"] +", but does not exist (-tss)" );				
 	}
+	vector<vector<string> > bank;
+	if (not template_bank(bank)){
+		errors.push_back("User specified templates, " + p["-templates"] + ", not as sigma,lambda,foot_print:... (-templates)");
+	}
 
 	return errors;
 }
+/**
+ * @brief The -templates list, one {sigma, lambda, foot_print} per entry
+ * (same units as -sigma, -lambda and -foot_print).
+ * @param bank entries (out), empty if -templates is
+ * @return false if an entry is not three numbers
+ */
+bool params::template_bank(vector<vector<string> > & bank){
+	bank.clear();
+	if (p["-templates"].empty()){
+		return true;
+	}
+	vector<string> entries 	= split_by_colon(p["-templates"], ":");
+	for (int i = 0; i < entries.size(); i++){
+		vector<string> fields 	= split_by_comma(entries[i], ",");
+		if (fields.size() != 3){
+			return false;
+		}
+		for (int f = 0; f < 3; f++){
+			if (fields[f].empty() or not is_number(fields[f])){
+				return false;
+			}
+		}
+		bank.push_back(fields);
+	}
+	return not bank.empty();
+}
+/**
+ * @brief Make one -templates entry this run's template, so get_header()
+ * describes it.
+ * @param entry sigma, lambda, foot_print (see template_bank)
+ */
+void params::use_template(const vector<string> & entry){
+	p["-sigma"] 		= entry[0];
+	p["-lambda"] 		= entry[1];
+	p["-foot_print"] 	= entry[2];
+	p["-templates"] 	= "";
+}
 /**
  * @brief 
  * 
@@ -261,6 +318,10 @@ void params::help(){
 	printf("              to perform maximum likelihood or a-posteriori parameter inference\n");
 	printf("              recommended for accuracy; especially for point estimate on\n");
 	printf("              RNA polymerase II loading position needed for TF ID-ing \n");
+	printf("cache     : \n");
+	printf("              converts the bedgraph input (-i/-j or -ij) once into a binary\n");
+	printf("              coverage cache, {-o}{-N}.tfitcov, which bidir and model then\n");
+	printf("              accept as -ij in place of the bedgraph files\n");
 	/*** 
 	printf("select    : \n");
 	printf("              model selection is performed via penalized bayesian information\n");
@@ -285,6 +346,12 @@ void params::help(){
 	printf("              chromosome[tab]start[tab]stop[tab]coverage[newline]\n");
 	printf("              coverage < 0 is assumed to correspond to reverse strand\n");
 	printf("              coverage > 0 is assumed to correspond to forward strand\n");
+	printf("              may also be a coverage cache made by the cache module\n");
+	printf("              -i/-j or -ij may also be bigWig files (.bw); with -i/-j\n");
+	printf("              both must be bigWig\n");
+	printf("              bedgraphs may be gzip or bgzip compressed (.gz); they are\n");
+	printf("              inflated into memory, so each MPI process needs RAM for the\n");
+	printf("              uncompressed size of the files (bgzip inflates in parallel)\n");
 	
 	printf("-k        : /path/to/interval/file\n");
 	printf("              this bed file is require for the model module\n");
@@ -319,6 +386,26 @@ void params::help(){
 	printf("              inference via EM (highly recommended for accuracy)\n");
 	printf("-ms_pen   : (positive floating) penalty term in BIC criteria for model selection\n");
 	printf("              (default = 1)\n");
+	printf("-stream   : (boolean integer) specific to the bidir module, load and scan a window\n");
+	printf("              of chromosomes at a time instead of the whole genome (default=0)\n");
+	printf("-mem      : (positive integer) with -stream, megabytes of binned coverage to hold\n");
+	printf("              at once; decides how many chromosomes a window has (default=2048)\n");
+	printf("-coarse   : (positive integer) specific to the bidir module, first scan at this many\n");
+	printf("              times -br and rescan only around likely hits.  Approximate: on\n");
+	printf("              simulated data with the defaults hits were identical for 2 to 256,\n");
+	printf("              but up to 0.13%% (<= 16) and 21%% (128) of the bins over -bct went\n");
+	printf("              unscored, so hit edges may differ (default=0, off; not with -scores)\n");
+	printf("-scores   : (path) write the template scan's BIC ratio of every bin here,\n");
+	printf("              as bedGraph or, for a path ending in %s, a binary track (default=none)\n", SCORE_EXT);
+	printf("-save_scan: (boolean integer) specific to the bidir module, save every bin's scores\n");
+	printf("              to {-o}{-N}-{ID}.tfitscan for -rethreshold; windows are then not\n");
+	printf("              skipped on their score (default=0)\n");
+	printf("-rethreshold: (path) specific to the bidir module, find the hits of a saved scan\n");
+	printf("              at this -bct and -FDR without reading bedgraphs; input, template,\n");
+	printf("              -pad and -br are those of the saved run (default=none)\n");
+	printf("-templates: (sigma,lambda,foot_print:...) specific to the bidir module, more templates\n");
+	printf("              scored in the same pass; each writes {-N}_template{n}-{ID}_prelim_bidir_hits.bed\n");
+	printf("              (default=none)\n");
 	
 	printf("\n");
 	printf("                    ....description of default parameters....          \n");	
@@ -334,6 +421,19 @@ void params::help(){
 	printf("              EM algorithm (default=2000)\n" );	                  
 	printf("-ct       : (positive decimal) EM log-likelihood convergence threshold\n");
 	printf("              (default=0.0001)\n" );	                  
+	printf("-em_tiles : (boolean integer) run the EM E-step over tiles of bins with the\n");
+	printf("              components held as arrays, the -rounds restarts of a model\n");
+	printf("              sharing each pass; same fits to rounding (default=0)\n" );
+	printf("-race     : (positive decimal) race the -rounds restarts of a model and\n");
+	printf("              abandon those whose log-likelihood can't catch the best one's\n");
+	printf("              if their gains keep shrinking; higher is more aggressive,\n");
+	printf("              1 takes that bound as is, 0.25 is safer (default=0, off)\n" );
+	printf("-warm_K   : (positive integer) start the fits of each K from the best fit\n");
+	printf("              of K-1 plus a component at its largest residual, and stop\n");
+	printf("              before -maxK once this many components in a row haven't paid\n");
+	printf("              their -ms_pen BIC penalty; an early stop on diminishing gains,\n");
+	printf("              it can miss a larger K that scores better and so change the\n");
+	printf("              selected model; 2 is more careful than 1 (default=0, off)\n" );
 	printf("-ALPHA_0  : hyperparameter (1) for the Normal Inverse Wishart prior for loading variance (sigma)\n" );	                  
 	printf("              (default=1; weak)\n" );	                  
 	printf("-BETA_0   : hyperparameter (2) for the Normal Inverse Wishart fprior for loading variance (sigma)\n" );	                  
@@ -382,6 +482,9 @@ void params::display(int nodes, int cores){
 	if (select){
 	header+="            ....BIC penalty optimization....                      \n";		
 	}
+	if (cache){
+	header+="               ...building coverage cache...                    \n";
+	}
 	printf("%s\n",header.c_str() );
 	printf("-N         : %s\n", p["-N"].c_str()  );
 	if (not p["-ij"].empty()){
@@ -409,10 +512,35 @@ void params::display(int nodes, int cores){
 	if (!model){
 	printf("-bct       : %s\n", p["-bct"].c_str());
 	}
+	if (bidir and stoi(p["-stream"])){
+		printf("-stream    : %s\n", p["-stream"].c_str());
+		printf("-mem       : %s\n", p["-mem"].c_str());
+	}
+	if (bidir and stoi(p["-coarse"]) > 1){
+		printf("-coarse    : %s\n", p["-coarse"].c_str());
+	}
+	if (bidir and stoi(p["-save_scan"])){
+		printf("-save_scan : %s\n", p["-save_scan"].c_str());
+	}
+	if (bidir and !p["-rethreshold"].empty()){
+		printf("-rethreshold: %s\n", p["-rethreshold"].c_str());
+	}
+	if (bidir and !p["-templates"].empty()){
+		printf("-templates : %s\n", p["-templates"].c_str());
+	}
 	if (model){
 		printf("-minK      : %s\n", p["-minK"].c_str());
 		printf("-maxK      : %s\n", p["-maxK"].c_str());
 	}
+	if (stoi(p["-em_tiles"])){
+		printf("-em_tiles  : %s\n", p["-em_tiles"].c_str());
+	}
+	if (stod(p["-race"]) > 0){
+		printf("-race      : %s\n", p["-race"].c_str());
+	}
+	if (stoi(p["-warm_K"])){
+		printf("-warm_K    : %s\n", p["-warm_K"].c_str());
+	}
 	printf("-threads   : %d\n",  cores);
 	printf("-MPI_np    : %d\n",  nodes);
 	printf("\nQuestions/Bugs? joseph[dot]azofeifa[at]colorado[dot]edu\n" );
@@ -446,6 +574,15 @@ string params::get_header(int ID){
 	if (ID==1){
 		header+="#-bct         : "+p["-bct"]+"\n";
 		header+="#-pad         : "+p["-pad"]+"\n";
+		if (stoi(p["-coarse"]) > 1){
+			header+="#-coarse      : "+p["-coarse"]+"\n";
+		}
+		if (!p["-templates"].empty()){
+			header+="#-templates   : "+p["-templates"]+"\n";
+		}
+		if (!p["-rethreshold"].empty()){
+			header+="#-rethreshold : "+p["-rethreshold"]+"\n";
+		}
 	}
 	if (ID!=1){
 		header+="#-elon        : "+p["-elon"]+"\n";
@@ -454,6 +591,15 @@ string params::get_header(int ID){
 		header+="#-mi          : "+p["-mi"]+"\n";
 		header+="#-ct          : "+p["-ct"]+"\n";
 		header+="#-rounds      : "+p["-rounds"]+"\n";
+		if (stoi(p["-em_tiles"])){
+			header+="#-em_tiles    : "+p["-em_tiles"]+"\n";
+		}
+		if (stod(p["-race"]) > 0){
+			header+="#-race        : "+p["-race"]+"\n";
+		}
+		if (stoi(p["-warm_K"])){
+			header+="#-warm_K      : "+p["-warm_K"]+"\n";
+		}
 	}
 	if (ID!=1){
 		header+="#-ALPHA_0     : "+p["-ALPHA_0"]+"\n";	
@@ -598,7 +744,7 @@ int read_in_parameters( char* argv[], params * P, int rank){
 	argv = ++argv;
 	if (not *argv){
 		if (rank==0){
-			printf("No module found, please specify either bidir, model or select\n");
+			printf("No module found, please specify either bidir, model, select or cache\n");
 		}
 		P->EXIT = 1;
 		return 1;
@@ -626,6 +772,9 @@ int read_in_parameters( char* argv[], params * P, int rank){
 		else if(F.size() == 6 and F.substr(0,6)=="select"){
 			P->select 	= 1;
 		}
+		else if(F.size() == 5 and F.substr(0,5)=="cache"){
+			P->cache 	= 1;
+		}
 		else{
 			if (rank == 0){
 				printf("couldn't understand user provided module option: %s\n",F.c_str() );
@@ -31,6 +31,7 @@ public:
 	bool model;
 	bool CONFIG;
 	bool select;
+	bool cache;
 
 	map<string, string> p2;
 	map<string, string> p3;
@@ -59,6 +60,8 @@ public:
 	void help();
 	string get_header(int);
 	vector<string> validate_parameters();
+	bool template_bank(vector<vector<string> > &);
+	void use_template(const vector<string> &);
 };
 
 /* Deprecated: These don't appear to have code anywhere 
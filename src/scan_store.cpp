@@ -0,0 +1,240 @@
+/**
+ * @file scan_store.cpp
+ * @author Robin Dowell
+ * @brief Saved template scan (.tfitscan) for changing -bct or -FDR later.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "scan_store.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief The saved scan of one process: {-o}{-N}-{ID}.tfitscan, and
+ * .part{rank} after it on ranks other than 0.
+ */
+string scan_store_name(string out_dir, string job_name, int job_ID, int rank){
+	string FILE 	= out_dir + job_name + "-" + to_string(job_ID) + ".tfitscan";
+	return rank==0 ? FILE : FILE + ".part" + to_string(rank);
+}
+
+/**
+ * @brief Start a saved scan; the header is filled in by close().
+ * @param FILE path
+ * @param options all options of the run (params::p)
+ * @param mean, std score distribution of the run
+ * @param fitted the distribution was fitted (-FDR 1)
+ * @param parts number of processes saving parts
+ * @param templates BIC arrays per segment
+ */
+scan_store_writer::scan_store_writer(string FILE, const map<string, string> & options, double mean, double std,
+		bool fitted, int parts, int templates){
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, SCAN_MAGIC, sizeof(H.magic));
+	H.version 	= SCAN_VERSION;
+	H.templates = templates, H.parts = parts, H.fitted = fitted;
+	H.mean 		= mean, H.std = std;
+	for (map<string, string>::const_iterator p = options.begin(); p != options.end(); p++){
+		text 	+= p->first + "\t" + p->second + "\n";
+	}
+	FH 	= fopen(FILE.c_str(), "wb");
+	ok 	= FH != NULL and fwrite(&H, sizeof(H), 1, FH) == 1;	// a placeholder until close()
+	if (FH == NULL){
+		printf("couldn't write scan to %s\n", FILE.c_str());
+	}
+	H.size 	= sizeof(H);
+}
+
+scan_store_writer::~scan_store_writer(){
+	close();
+}
+
+bool scan_store_writer::good() const{
+	return ok;
+}
+
+/**
+ * @brief Append one segment's scan.
+ * @param chrom chromosome
+ * @param start genome coordinate of x = 0 (segment::start)
+ * @param x bin coordinates (segment::X[0])
+ * @param bins number of bins
+ * @param BIC_values one array per template
+ * @param cut_f, cut_r coverage a hit needs (see scan_cut)
+ */
+void scan_store_writer::add(string chrom, double start, const double * x, int bins,
+		const vector<double *> & BIC_values, const double * densities, const double * densities_r,
+		double cut_f, double cut_r){
+	if (not ok){
+		return;
+	}
+	scan_segment B;
+	memset(&B, 0, sizeof(B));
+	B.name 	= names.size(), B.name_len = chrom.size();	// relative until close()
+	B.bins 	= bins, B.offset = H.size;
+	B.start = start, B.cut_f = cut_f, B.cut_r = cut_r;
+	size_t n 	= B.bins;
+	ok 	= fwrite(x, sizeof(double), n, FH) == n
+		and fwrite(densities, sizeof(double), n, FH) == n
+		and fwrite(densities_r, sizeof(double), n, FH) == n;
+	for (uint32_t t = 0; t < H.templates and ok; t++){
+		ok 	= fwrite(BIC_values[t], sizeof(double), n, FH) == n;
+	}
+	H.size 	+= (3 + H.templates)*n*sizeof(double);
+	table.push_back(B);
+	names 	+= chrom;
+}
+
+/**
+ * @brief Write the segment table, names and parameters, then the header.
+ * @return false if any write failed
+ */
+bool scan_store_writer::close(){
+	if (FH == NULL){
+		return false;
+	}
+	H.segments 	= table.size();
+	H.table 	= H.size;
+	H.names 	= H.table + table.size()*sizeof(scan_segment);
+	H.params 	= H.names + names.size();
+	H.size 		= H.params + text.size();
+	for (size_t b = 0; b < table.size(); b++){
+		table[b].name 	+= H.names;
+	}
+	if (ok and not table.empty()){
+		ok 	= fwrite(&table[0], sizeof(scan_segment), table.size(), FH) == table.size();
+	}
+	ok 	= ok and fwrite(names.data(), 1, names.size(), FH) == names.size()
+		and fwrite(text.data(), 1, text.size(), FH) == text.size()
+		and fseek(FH, 0, SEEK_SET) == 0 and fwrite(&H, sizeof(H), 1, FH) == 1;
+	ok 	= (fclose(FH) == 0) and ok;
+	FH 	= NULL;
+	return ok;
+}
+
+/**
+ * @brief Constructor: scan_store class (nothing mapped)
+ */
+scan_store::scan_store(){
+	data 	= NULL;
+	length 	= 0;
+}
+
+scan_store::~scan_store(){
+	close();
+}
+
+/**
+ * @brief Map a saved scan and check that it is complete.
+ * @param FILE path to a .tfitscan file (or one of its parts)
+ * @return false if it couldn't be mapped or is not a valid scan
+ */
+bool scan_store::open(string FILE){
+	close();
+	int fd 	= ::open(FILE.c_str(), O_RDONLY);
+	if (fd < 0){
+		printf("couldn't open saved scan %s\n", FILE.c_str());
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 or size_t(st.st_size) < sizeof(scan_header)){
+		::close(fd);
+		printf("%s is not a saved scan\n", FILE.c_str());
+		return false;
+	}
+	length 	= st.st_size;
+	void * m 	= mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (m == MAP_FAILED){
+		length 	= 0;
+		printf("couldn't map saved scan %s\n", FILE.c_str());
+		return false;
+	}
+	data 	= (const char *)m;
+	const scan_header & H 	= header();
+	bool good 	= memcmp(H.magic, SCAN_MAGIC, sizeof(H.magic)) == 0 and H.version == SCAN_VERSION
+		and H.size == length and H.table + H.segments*sizeof(scan_segment) == H.names
+		and H.names <= H.params and H.params <= length and H.templates > 0;
+	for (int b = 0; good and b < segments(); b++){
+		const scan_segment & B 	= block(b);
+		good 	= B.name >= H.names and B.name + B.name_len <= H.params
+			and B.offset >= sizeof(scan_header)
+			and B.offset + (3 + H.templates)*B.bins*sizeof(double) <= H.table;
+	}
+	if (not good){
+		printf("%s is not a valid saved scan (version %d expected) or is truncated\n", FILE.c_str(), SCAN_VERSION);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void scan_store::close(){
+	if (data != NULL){
+		munmap((void *)data, length);
+	}
+	data 	= NULL;
+	length 	= 0;
+}
+
+const scan_header & scan_store::header() const{
+	return *(const scan_header *)data;
+}
+
+int scan_store::segments() const{
+	return header().segments;
+}
+
+const scan_segment & scan_store::block(int b) const{
+	return ((const scan_segment *)(data + header().table))[b];
+}
+
+string scan_store::name(int b) const{
+	return string(data + block(b).name, block(b).name_len);
+}
+
+const double * scan_store::x(int b) const{
+	return (const double *)(data + block(b).offset);
+}
+
+const double * scan_store::densities(int b) const{
+	return x(b) + block(b).bins;
+}
+
+const double * scan_store::densities_r(int b) const{
+	return x(b) + 2*block(b).bins;
+}
+
+const double * scan_store::BIC(int b, int t) const{
+	return x(b) + (3 + t)*block(b).bins;
+}
+
+/**
+ * @brief The options of the run that saved the scan.
+ * @return option -> value
+ */
+map<string, string> scan_store::parameters() const{
+	map<string, string> p;
+	const scan_header & H 	= header();
+	string all(data + H.params, H.size - H.params);
+	size_t a 	= 0;
+	while (a < all.size()){
+		size_t e 	= all.find('\n', a);
+		if (e == string::npos){
+			e 	= all.size();
+		}
+		size_t t 	= all.find('\t', a);
+		if (t < e){
+			p[all.substr(a, t - a)] 	= all.substr(t + 1, e - t - 1);
+		}
+		a 	= e + 1;
+	}
+	return p;
+}
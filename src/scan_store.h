@@ -0,0 +1,127 @@
+/**
+ * @file scan_store.h
+ * @author Robin Dowell
+ * @brief Saved template scan (.tfitscan) for changing -bct or -FDR later.
+ * Every bin's window sums and BIC ratios do not depend on the threshold,
+ * so bidir -save_scan 1 keeps them, with each segment's coverage cut, the
+ * fitted score distribution and the run's parameters; bidir -rethreshold
+ * then finds the hits again without reading the bedgraphs.
+ *
+ * Layout (native byte order, all offsets in bytes from the start of file):
+ *   scan_header
+ *   per segment:	double x[bins], densities[bins], densities_r[bins],
+ *					BIC[templates][bins]
+ *   scan_segment[segments]
+ *   names			segment chromosome names, not NUL terminated
+ *   parameters		"-option\tvalue\n" for every option of the run
+ * Under MPI every process saves its own segments; rank r > 0 writes
+ * {file}.part{r} and the header of each says how many parts there are.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef scan_store_H
+#define scan_store_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define SCAN_MAGIC "TFITSCN"	//!< first 8 bytes of every saved scan (with the NUL)
+#define SCAN_VERSION 1
+
+/**
+ * @brief Fixed size header at the start of a saved scan.
+ */
+struct scan_header{
+	char magic[8];		//!< SCAN_MAGIC
+	uint32_t version;	//!< SCAN_VERSION
+	uint32_t templates;	//!< BIC arrays per segment (-sigma/... then -templates)
+	uint32_t parts;		//!< files the scan is split over (MPI processes)
+	uint32_t fitted;	//!< 1 if mean and std were fitted (-FDR 1)
+	double mean, std;	//!< score distribution of the run (slice_ratio)
+	uint64_t segments;	//!< entries in the segment table
+	uint64_t table;		//!< offset of the segment table
+	uint64_t names;		//!< offset of the names
+	uint64_t params;	//!< offset of the parameters
+	uint64_t size;		//!< total file size
+};
+
+/**
+ * @brief One segment: where its arrays are and what a hit in it needs.
+ */
+struct scan_segment{
+	uint64_t name;		//!< offset of the chromosome name
+	uint32_t name_len;	//!< characters in the name
+	uint32_t reserved;
+	uint64_t bins;		//!< bins (segment::XN)
+	uint64_t offset;	//!< offset of x[]
+	double start;		//!< segment::start
+	double cut_f, cut_r;	//!< coverage a hit needs on each strand
+};
+
+/**
+ * @brief Writes a saved scan one segment at a time.
+ */
+class scan_store_writer{
+public:
+	// Constructors
+	scan_store_writer(string, const map<string, string> &, double, double, bool, int, int);	// FILE, options, mean, std, fitted, parts, templates
+	~scan_store_writer();
+
+	/* FUNCTIONS: */
+	bool good() const;
+	void add(string, double, const double *, int, const vector<double *> &, const double *, const double *, double, double);
+	bool close();
+
+private:
+	FILE * FH;
+	bool ok;
+	scan_header H;
+	vector<scan_segment> table;
+	string names;
+	string text;	//!< the parameters
+
+	scan_store_writer(const scan_store_writer &);
+	scan_store_writer & operator=(const scan_store_writer &);
+};
+
+/**
+ * @brief Read only view of a mapped saved scan (one part).
+ */
+class scan_store{
+public:
+	// Constructors
+	scan_store();
+	~scan_store();
+
+	/* FUNCTIONS: */
+	bool open(string);	// map FILE, false (with a message) if not a valid scan
+	void close();
+	const scan_header & header() const;
+	int segments() const;
+	const scan_segment & block(int) const;
+	string name(int) const;
+	const double * x(int) const;
+	const double * densities(int) const;
+	const double * densities_r(int) const;
+	const double * BIC(int, int) const;	// segment, template
+	map<string, string> parameters() const;
+
+private:
+	const char * data;	//!< the mapped file
+	size_t length;		//!< bytes mapped
+
+	scan_store(const scan_store &);
+	scan_store & operator=(const scan_store &);
+};
+
+string scan_store_name(string, string, int, int);	// -o, -N, job ID, rank -> file of that process
+
+#endif
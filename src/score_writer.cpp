@@ -0,0 +1,293 @@
+/**
+ * @file score_writer.cpp
+ * @author Robin Dowell
+ * @brief The -scores track, written on a background thread.
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "score_writer.h"
+
+#include <string.h>
+
+using namespace std;
+
+/**
+ * @brief Open the track and start the writer thread.  A file that cannot
+ * be opened is reported once; pushed blocks are then dropped.
+ * @param FILE path of the track
+ */
+score_writer::score_writer(string FILE){
+	binary 	= FILE.size() > strlen(SCORE_EXT)
+		and FILE.compare(FILE.size() - strlen(SCORE_EXT), string::npos, SCORE_EXT) == 0;
+	closed = false, done = false, pos = 0;
+	FH 	= fopen(FILE.c_str(), "wb");
+	ok 	= FH != NULL;
+	if (not ok){
+		printf("couldn't write scores to %s\n", FILE.c_str());
+		return;
+	}
+	if (binary){	// a zeroed header until close() knows where things are
+		score_header H;
+		memset(&H, 0, sizeof(H));
+		ok 	= fwrite(&H, sizeof(H), 1, FH) == 1;
+		pos 	= sizeof(H);
+	}
+	worker 	= thread(&score_writer::run, this);
+}
+
+score_writer::~score_writer(){
+	close();
+}
+
+bool score_writer::good() const{
+	return ok;
+}
+
+/**
+ * @brief Queue a block for writing; waits while SCORE_QUEUE are queued.
+ * @param B scores of one segment (left empty)
+ */
+void score_writer::push(score_block & B){
+	if (FH == NULL or done){
+		return;
+	}
+	unique_lock<mutex> lock(m);
+	not_full.wait(lock, [this]{ return blocks.size() < SCORE_QUEUE; });
+	blocks.push_back(score_block());
+	blocks.back().chrom.swap(B.chrom);
+	blocks.back().edges.swap(B.edges);
+	blocks.back().values.swap(B.values);
+	not_empty.notify_one();
+}
+
+/**
+ * @brief Write everything queued, finish the file and stop the thread.
+ * @return false if the track could not be written in full
+ */
+bool score_writer::close(){
+	if (done){
+		return ok;
+	}
+	done 	= true;
+	if (FH == NULL){
+		return false;
+	}
+	{
+		lock_guard<mutex> lock(m);
+		closed 	= true;
+		not_empty.notify_all();
+	}
+	worker.join();
+	if (binary and ok){
+		ok 	= finish();
+	}
+	ok 	= (fclose(FH) == 0) and ok;
+	FH 	= NULL;
+	return ok;
+}
+
+/**
+ * @brief The writer thread: take blocks off the queue until close().
+ */
+void score_writer::run(){
+	vector<char> text;
+	text.reserve(SCORE_BUFFER + 1024);
+	while (true){
+		score_block B;
+		{
+			unique_lock<mutex> lock(m);
+			not_empty.wait(lock, [this]{ return closed or not blocks.empty(); });
+			if (blocks.empty()){
+				break;
+			}
+			B.chrom.swap(blocks.front().chrom);
+			B.edges.swap(blocks.front().edges);
+			B.values.swap(blocks.front().values);
+			blocks.pop_front();
+			not_full.notify_one();
+		}
+		if (not ok){
+			continue;	// keep draining so push() never waits forever
+		}
+		if (binary){
+			write_binary(B);
+		}else{
+			write_bedgraph(B, text);
+		}
+	}
+	if (ok and not text.empty()){
+		ok 	= fwrite(&text[0], 1, text.size(), FH) == text.size();
+	}
+}
+
+/**
+ * @brief Append an integer in decimal.
+ */
+static void put_int(vector<char> & text, int32_t v){
+	char digits[12];
+	int n 	= 0;
+	uint32_t u 	= v < 0 ? -uint32_t(v) : uint32_t(v);
+	do{
+		digits[n++] 	= '0' + u % 10;
+		u 	/= 10;
+	}while (u > 0);
+	if (v < 0){
+		text.push_back('-');
+	}
+	while (n > 0){
+		text.push_back(digits[--n]);
+	}
+}
+
+/**
+ * @brief One bedGraph line per run of bins whose scores print the same
+ * (to_string(), i.e. "%f"), as the text is buffered SCORE_BUFFER at a time.
+ * @param B block
+ * @param text pending output (in/out)
+ */
+void score_writer::write_bedgraph(const score_block & B, vector<char> & text){
+	int n 	= B.values.size();
+	char value[400], next[400];	// room for "%f" of any double
+	int r 	= 0;
+	while (r < n and ok){
+		snprintf(value, sizeof(value), "%f", B.values[r]);
+		int s 	= r + 1;
+		while (s < n){
+			if (B.values[s] != B.values[s-1]){
+				snprintf(next, sizeof(next), "%f", B.values[s]);
+				if (strcmp(next, value) != 0){
+					break;
+				}
+			}
+			s++;
+		}
+		text.insert(text.end(), B.chrom.begin(), B.chrom.end());
+		text.push_back('\t');
+		put_int(text, B.edges[r]);
+		text.push_back('\t');
+		put_int(text, B.edges[s]);
+		text.push_back('\t');
+		text.insert(text.end(), value, value + strlen(value));
+		text.push_back('\n');
+		if (text.size() >= SCORE_BUFFER){
+			ok 	= fwrite(&text[0], 1, text.size(), FH) == text.size();
+			text.clear();
+		}
+		r 	= s;
+	}
+}
+
+/**
+ * @brief Append a block of runs of equal (float) score and note it in the
+ * block table.
+ * @param B block
+ */
+void score_writer::write_binary(const score_block & B){
+	int n 	= B.values.size();
+	vector<int32_t> edges;
+	vector<float> values;
+	for (int r = 0; r < n; r++){
+		float v 	= B.values[r];
+		if (values.empty() or v != values.back()){
+			edges.push_back(B.edges[r]);
+			values.push_back(v);
+		}
+	}
+	if (n > 0){
+		edges.push_back(B.edges[n]);
+	}
+	score_chrom C;
+	memset(&C, 0, sizeof(C));
+	C.name 	= names.size(), C.name_len = B.chrom.size();	// relative until finish()
+	C.runs 	= values.size();
+	C.offset 	= pos;
+	if (not values.empty()){
+		ok 	= fwrite(&edges[0], sizeof(int32_t), edges.size(), FH) == edges.size()
+			and fwrite(&values[0], sizeof(float), values.size(), FH) == values.size();
+	}
+	pos 	+= edges.size()*sizeof(int32_t) + values.size()*sizeof(float);
+	table.push_back(C);
+	names 	+= B.chrom;
+}
+
+/**
+ * @brief Write the block table and names after the data, then the header.
+ * @return false on a failed write
+ */
+bool score_writer::finish(){
+	score_header H;
+	memset(&H, 0, sizeof(H));
+	memcpy(H.magic, SCORE_MAGIC, sizeof(H.magic));
+	H.version 	= SCORE_VERSION;
+	H.blocks 	= table.size();
+	H.table 	= (pos + 7) & ~uint64_t(7);
+	H.names 	= H.table + table.size()*sizeof(score_chrom);
+	H.size 		= H.names + names.size();
+	for (size_t b = 0; b < table.size(); b++){
+		table[b].name 	+= H.names;
+	}
+	char pad[8] 	= {0};
+	bool good 	= fwrite(pad, 1, H.table - pos, FH) == H.table - pos;
+	if (not table.empty()){
+		good 	= good and fwrite(&table[0], sizeof(score_chrom), table.size(), FH) == table.size();
+	}
+	good 	= good and fwrite(names.data(), 1, names.size(), FH) == names.size();
+	good 	= good and fseek(FH, 0, SEEK_SET) == 0 and fwrite(&H, sizeof(H), 1, FH) == 1;
+	return good;
+}
+
+/**
+ * @brief Read a binary track back, one block per table entry.
+ * @param FILE path of the track
+ * @param B blocks (out), values as stored (float precision)
+ * @return false (with a message) if the file is missing or malformed
+ */
+bool read_score_track(string FILE, vector<score_block> & B){
+	B.clear();
+	std::FILE * FH 	= fopen(FILE.c_str(), "rb");
+	if (FH == NULL){
+		printf("couldn't open scores %s\n", FILE.c_str());
+		return false;
+	}
+	vector<char> data;
+	char chunk[1<<16];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), FH)) > 0){
+		data.insert(data.end(), chunk, chunk + n);
+	}
+	fclose(FH);
+	score_header H;
+	bool good 	= data.size() >= sizeof(H);
+	if (good){
+		memcpy(&H, &data[0], sizeof(H));
+		good 	= memcmp(H.magic, SCORE_MAGIC, sizeof(H.magic)) == 0 and H.version == SCORE_VERSION
+			and H.size == data.size() and H.table <= H.names and H.names <= H.size
+			and (H.names - H.table) == H.blocks*sizeof(score_chrom);
+	}
+	for (uint64_t b = 0; good and b < H.blocks; b++){
+		score_chrom C;
+		memcpy(&C, &data[H.table + b*sizeof(C)], sizeof(C));
+		uint64_t bytes 	= C.runs ? (2*uint64_t(C.runs) + 1)*4 : 0;
+		good 	= C.name >= H.names and C.name + C.name_len <= H.size
+			and C.offset >= sizeof(H) and C.offset + bytes <= H.table;
+		if (not good){
+			break;
+		}
+		score_block S;
+		S.chrom.assign(&data[C.name], C.name_len);
+		if (C.runs){
+			S.edges.resize(C.runs + 1);
+			vector<float> values(C.runs);
+			memcpy(&S.edges[0], &data[C.offset], S.edges.size()*sizeof(int32_t));
+			memcpy(&values[0], &data[C.offset + S.edges.size()*sizeof(int32_t)], C.runs*sizeof(float));
+			S.values.assign(values.begin(), values.end());
+		}
+		B.push_back(S);
+	}
+	if (not good){
+		printf("%s is not a Tfit score track (or is truncated)\n", FILE.c_str());
+		B.clear();
+	}
+	return good;
+}
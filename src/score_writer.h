@@ -0,0 +1,115 @@
+/**
+ * @file score_writer.h
+ * @author Robin Dowell
+ * @brief The -scores track: every bin's BIC ratio from the template scan.
+ * The scan hands each segment's scores over as a block; a background
+ * thread merges runs of equal value and writes them, so formatting and
+ * disk I/O overlap the scan.  A -scores path ending in SCORE_EXT gets a
+ * binary track, anything else a bedGraph.
+ *
+ * Binary layout (native byte order, offsets in bytes from the start of file):
+ *   score_header
+ *   per block:	int32_t edges[runs + 1], float values[runs] (4 byte aligned)
+ *   score_chrom[blocks]	in the order the blocks were written
+ *   names				chromosome names, not NUL terminated
+ * Run r covers edges[r], ... < edges[r+1] with score values[r].
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef score_writer_H
+#define score_writer_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define SCORE_MAGIC "TFITSCR"	//!< first 8 bytes of a binary track (with the NUL)
+#define SCORE_VERSION 1
+#define SCORE_EXT ".tfitscore"	//!< -scores suffix that selects the binary track
+#define SCORE_QUEUE 8			//!< blocks that may wait for the writer
+#define SCORE_BUFFER (4<<20)	//!< bytes of bedGraph text per write
+
+/**
+ * @brief Fixed size header at the start of a binary track.
+ */
+struct score_header{
+	char magic[8];		//!< SCORE_MAGIC
+	uint32_t version;	//!< SCORE_VERSION
+	uint32_t reserved;
+	uint64_t blocks;	//!< entries in the block table
+	uint64_t table;		//!< offset of the block table
+	uint64_t names;		//!< offset of the names
+	uint64_t size;		//!< total file size
+};
+
+/**
+ * @brief One block (segment) of a binary track and where its runs are.
+ */
+struct score_chrom{
+	uint64_t name;		//!< offset of the name
+	uint32_t name_len;	//!< characters in the name
+	uint32_t runs;		//!< runs in the block
+	uint64_t offset;	//!< offset of edges[]; values[] follow them
+};
+
+/**
+ * @brief Scores of one segment: bin i covers edges[i], ... < edges[i+1].
+ */
+class score_block{
+public:
+	string chrom;
+	vector<int32_t> edges;	//!< one more than values
+	vector<double> values;
+};
+
+/**
+ * @brief Writes the -scores track on its own thread.  push() hands a block
+ * over (waiting while SCORE_QUEUE blocks are queued); close() writes what
+ * is left, finishes the file and reports whether every write succeeded.
+ */
+class score_writer{
+public:
+	// Constructors
+	score_writer(string);	// path; binary if it ends in SCORE_EXT
+	~score_writer();
+
+	/* FUNCTIONS: */
+	bool good() const;	// opened and nothing failed so far
+	void push(score_block &);	// takes the block's contents
+	bool close();
+
+private:
+	bool binary;
+	FILE * FH;
+	atomic<bool> ok;	//!< set false by either thread on a failed write
+	bool closed, done;
+	deque<score_block> blocks;
+	mutex m;
+	condition_variable not_full, not_empty;
+	thread worker;
+	vector<score_chrom> table;	//!< binary: blocks written so far
+	string names;			//!< binary: their chromosome names
+	uint64_t pos;			//!< binary: end of the data written
+
+	void run();
+	void write_bedgraph(const score_block &, vector<char> &);
+	void write_binary(const score_block &);
+	bool finish();
+
+	score_writer(const score_writer &);
+	score_writer & operator=(const score_writer &);
+};
+
+bool read_score_track(string, vector<score_block> &);	// binary track -> blocks (values as stored)
+
+#endif
@@ -22,6 +22,7 @@
 #include "FDR.h"
 #include "load.h"
 #include "model.h"
+#include "template_scan.h"
 
 using namespace std;
 
@@ -77,54 +78,213 @@ int sample_centers(vector<double> centers, double p){
 
 
 
-void BIC_template(segment * data,  double * BIC_values, double * densities, double * densities_r, double window, 
-		  double sigma, double lambda, double foot_print, double pi, double w){
-  double vl;
+/**
+ * @brief Grow the per-thread counters to at least n threads.
+ * @param n number of threads
+ */
+void scan_load::resize(int n){
+  if (seconds.size() < n){
+    seconds.resize(n, 0.0), tiles.resize(n, 0), bins.resize(n, 0), scored.resize(n, 0);
+    cut.resize(n, 0), bounded.resize(n, 0), coarse.resize(n, 0);
+  }
+}
+
+/**
+ * @brief One line per thread, then the busiest thread's time over the mean.
+ * @return string 
+ */
+string scan_load::report(){
+  string text;
+  double total = 0, most = 0;
+  for (int t = 0; t < seconds.size(); t++){
+    text += "thread " + to_string(t) + "             : " + to_string(tiles[t]) + " tiles, "
+      + to_string(bins[t]) + " bins, " + to_string(scored[t]) + " scored ("
+      + to_string(cut[t]) + " cut on coverage, " + to_string(bounded[t]) + " on the bound, "
+      + to_string(coarse[t]) + " left out coarse), "
+      + to_string(seconds[t]) + " s\n";
+    total += seconds[t], most = max(most, seconds[t]);
+  }
+  if (total > 0){
+    text += "max/mean thread time : " + to_string(most*seconds.size()/total) + "\n";
+  }
+  return text;
+}
+
+/**
+ * @brief The coarse pass of the -coarse scan.  Bins are pooled into blocks
+ * of F lattice steps (F = C.step / T.step), each block's window is scored
+ * at that resolution with C, and only the bins around blocks that could
+ * hold a hit are kept for the full resolution scan.  A block is dropped if
+ * its windows cannot clear the coverage cut (exact) or if its coarse ratio
+ * is more than COARSE_MARGIN below cut.bic (approximate).
+ *
+ * That step has no usable bound in terms of F: pooling moves each read by
+ * less than F steps, but a read that moves can cross the window's edge or
+ * slide along the steep side of the template, so a worst case is loose
+ * and depends on -sigma/-lambda as much as on F.  The margin is measured
+ * instead, on simulated bedgraphs (3 and 10
+ * chromosomes, 257 and 5024 hits) with the default -br, -bct and template.
+ * There the coarse ratio around a bin fell short of its full ratio by at
+ * most 0.13 at F = 2, 0.20 at F = 4-8 and 0.26 at F = 16-128.  With the
+ * 0.1 margin this skips up to 0.02% of the bins above the threshold for
+ * F <= 8, 0.13% at F = 16, 1.6% at F = 64 and 21% at F = 128.  Hits came
+ * out identical to the single resolution scan for every F from 2 to 256,
+ * since a hit is still called from its other bins.  Denser or sharper
+ * peaks may lose bins at the edges of hits.
+ * @param data segment
+ * @param L lattice indices of the bins (see template_scan::lattice)
+ * @param window half width of the scan window
+ * @param C template at the coarse resolution
+ * @param F coarse block width in lattice steps
+ * @param cut what a hit needs
+ * @param keep bins to scan at full resolution are set (NN long, not cleared)
+ */
+static void coarse_candidates(segment * data, const vector<int> & L, double window,
+			      const template_scan & C, int F, const scan_cut & cut, vector<char> & keep){
   int NN 	= int(data->XN);
-  int threads  	= omp_get_max_threads();
-  int counts 		= NN / threads;
-  #pragma omp parallel num_threads(threads)
-  {
-    int tid 	= omp_get_thread_num();
-    int start 	= tid*counts;
-    int stop 	= (tid+1)*(counts);
-    if (tid+1 == threads){
-      stop 	= NN;
-    }
-    int j = start, k =start;
-    double N_pos=0,N_neg=0;
-    double total_density;
+  const double * f = data->X[1], * r = data->X[2];
+  // pool the bins; a block sits at its left edge on the coarse lattice
+  bin_matrix B(3, NN);
+  int nb 	= 0, last = -1;
+  for (int m = 0; m < NN; m++){
+    int b 	= L[m] / F;
+    if (b != last){
+      B[0][nb] 	= b*C.step;
+      last 	= b, nb++;
+    }
+    B[1][nb-1] 	+= f[m], B[2][nb-1] += r[m];
+  }
+  B.shrink(max(nb, 1));
+  vector<int> LB;
+  C.lattice(B[0], nb, LB);
+
+  const double * xb 	= B[0];
+  int j = 0, k = 0;
+  double N_pos = 0, N_neg = 0;
+  for (int c = 0; c < nb; c++){
+    while (j < nb and (xb[j] - xb[c]) < -window){
+      N_pos-=B[1][j], N_neg-=B[2][j];
+      j++;
+    }
+    while (k < nb and (xb[k] - xb[c]) < window){
+      N_pos+=B[1][k], N_neg+=B[2][k];
+      k++;
+    }
+    // every full resolution window centered in this block lies in here
+    int lo 	= data->find(xb[c] - window), hi = data->find(xb[c] + C.step + window);
+    if (not (data->sum(1, lo, hi) > cut.f and data->sum(2, lo, hi) > cut.r)){
+      continue;
+    }
+    if (k < nb and N_pos > 0 and N_neg > 0
+	and C.BIC(B, LB, j, k, c, N_pos, N_neg) < cut.bic - COARSE_MARGIN){
+      continue;
+    }
+    // this block and its neighbours on either side
+    int a 	= data->find(xb[c] - C.step), z = data->find(xb[c] + 2*C.step);
+    for (int m = a; m < z; m++){
+      keep[m] 	= 1;
+    }
+  }
+}
+
+/**
+ * @brief Score every bin of a segment against each template of a bank.
+ * The bins are cut into tiles of SCAN_TILE that threads take dynamically;
+ * each tile finds its own window at its first bin, so results do not
+ * depend on threads.  Window counts come from the segment's running totals
+ * and are found once per bin for all templates, which share the lattice
+ * and the window.
+ * @param BIC_values one array of ratios per template (out)
+ * @param T templates
+ * @param cut windows that cannot be hits get a ratio of 0 without being
+ *  scored: coverage is checked first, then the O(1) and the per-bin
+ *  T.bound() (NULL scores every window)
+ * @param C with cut, first pass at this coarser resolution, one per
+ *  template (empty for none); a bin is kept if any template keeps it
+ * @param load per-thread work is added here (NULL to skip)
+ */
+void BIC_template(segment * data, const vector<double *> & BIC_values, double * densities, double * densities_r, double window, 
+		  const vector<const template_scan *> & T, const scan_cut * cut, const vector<const template_scan *> & C, scan_load * load){
+  int NN 	= int(data->XN);
+  int NT 	= T.size();
+  vector<int> L;
+  T[0]->lattice(data->X[0], NN, L);	// empty if off the lattice: T.BIC then uses BIC3
+  vector<char> keep;	// empty: scan every bin
+  if (cut != NULL and not C.empty() and not L.empty() and NN > 0){
+    keep.assign(NN, 0);
+    for (int b = 0; b < NT; b++){
+      coarse_candidates(data, L, window, *C[b], int(lround(C[b]->step / T[b]->step)), *cut, keep);
+    }
+  }
+  int num_proc 	= omp_get_max_threads();
+  int ntiles 	= (NN + SCAN_TILE - 1) / SCAN_TILE;
+  if (load != NULL){
+    load->resize(num_proc);
+  }
+  #pragma omp parallel for schedule(dynamic) num_threads(num_proc)
+  for (int t = 0; t < ntiles; t++){
+    double began 	= omp_get_wtime();
+    int start 	= t*SCAN_TILE;
+    int stop 	= min(NN, start + SCAN_TILE);
+    const double * x 	= data->X[0];
+    // the window as the bins before this tile would have left it
+    int j 	= data->find(x[start] - window), k = data->find(x[start] + window);
+    double N_pos, N_neg;
+    long scored = 0, cuts = 0, bounded = 0, coarse = 0;
     for (int i = start; i < stop; i++){
-      while (j < data->XN and (data->X[0][j] - data->X[0][i]) < -window){
-	N_pos-=data->X[1][j];
-	N_neg-=data->X[2][j];
+      if (not keep.empty() and not keep[i]){
+	for (int b = 0; b < NT; b++){
+	  BIC_values[b][i] 	= 0;
+	}
+	densities[i] 	= 0;
+	densities_r[i] 	= 0;
+	coarse++;
+	continue;
+      }
+      while (j < NN and (x[j] - x[i]) < -window){
 	j++;
       }
-      while (k < data->XN and (data->X[0][k] - data->X[0][i]) < window){
-	N_pos+=data->X[1][k];
-	N_neg+=data->X[2][k];
+      while (k < NN and (x[k] - x[i]) < window){
 	k++;
       }
-      int aa=k < data->XN;
-      int bb=j < data->XN;
-      int cc=N_neg > 0;
-      int dd=N_pos > 0;
+      N_pos 	= data->sum(1, j, k), N_neg = data->sum(2, j, k);
       
-      if (k < data->XN  and j < data->XN and k!=j and N_neg > 0 and N_pos > 0 and (data->X[0][k] - data->X[0][j]) > 1.75*window  ){
-	total_density 	= (N_pos / (data->X[0][k] - data->X[0][j])) + (N_neg / (data->X[0][k] - data->X[0][j]));
+      if (k < NN  and j < NN and k!=j and N_neg > 0 and N_pos > 0 and (x[k] - x[j]) > 1.75*window  ){
 	densities[i] 	= N_pos ;
 	densities_r[i] 	= N_neg ;
 	
-	double mu 	= (data->X[0][k] + data->X[0][j]) /2.;
-		
-	BIC_values[i] 	= BIC3(data->X,  j,  k,  i, N_pos,  N_neg, 
-			       sigma, lambda, foot_print, pi, w);
+	if (cut != NULL and not (N_pos > cut->f and N_neg > cut->r)){
+	  for (int b = 0; b < NT; b++){
+	    BIC_values[b][i] 	= 0;
+	  }
+	  cuts++;
+	  continue;
+	}
+	for (int b = 0; b < NT; b++){
+	  if (cut != NULL and cut->bic > 0 and not L.empty()
+	      and (T[b]->bound(x[k] - x[j], N_pos, N_neg) + BOUND_SLACK <= cut->bic
+		   or T[b]->bound(data->X, L, j, k, i, N_pos, N_neg) + BOUND_SLACK <= cut->bic)){
+	    BIC_values[b][i] 	= 0;
+	    bounded++;
+	  }else{
+	    BIC_values[b][i] 	= T[b]->BIC(data->X, L, j, k, i, N_pos, N_neg);
+	    scored++;
+	  }
+	}
       }else{
-	BIC_values[i] 	= 0;
+	for (int b = 0; b < NT; b++){
+	  BIC_values[b][i] 	= 0;
+	}
 	densities[i] 	= 0;
 	densities_r[i] 	= 0;
       }
     }
+    if (load != NULL){
+      int tid 	= omp_get_thread_num();
+      load->seconds[tid] 	+= omp_get_wtime() - began;
+      load->tiles[tid]++, load->bins[tid] += stop - start, load->scored[tid] += scored;
+      load->cut[tid] += cuts, load->bounded[tid] += bounded, load->coarse[tid] += coarse;
+    }
   }
 }
 
@@ -135,6 +295,61 @@ bool check_hit(double a, double b, double c, double x, double y, double z){
   return false;
 } 
 
+/**
+ * @brief Runs of bins that pass check_hit() become hits, which are added
+ * to bounds and merged.
+ * @param x bin coordinates (segment::X[0])
+ * @param XN number of bins
+ * @param offset genome coordinate of x = 0 (segment::start)
+ * @param BIC_values ratio of each bin
+ * @param SC gives the ratio threshold and p-values
+ * @param cut_f forward coverage a hit needs
+ * @param cut_r reverse coverage a hit needs
+ * @param bounds hits so far (in/out)
+ */
+void collect_hits(const double * x, int XN, double offset, const double * BIC_values,
+		  const double * densities, const double * densities_r,
+		  slice_ratio & SC, double cut_f, double cut_r, double window, double ns,
+		  vector<vector<double> > & bounds){
+  double start=-1, rN=0.0 , rF=0.0, rR=0.0, rB=0.0;
+  vector<vector<double>> HITS;
+  for (int j = 1; j<XN-1; j++){
+    bool HIT = check_hit(BIC_values[j], densities[j], densities_r[j], SC.threshold, cut_f, cut_r  );
+    if ( HIT ) {
+      if (start < 0){
+	start = x[j-1]*ns+offset;
+      }
+      start+=1, rN+=1 , rF+=densities[j], rR+=densities_r[j], rB+=log10( SC.pvalue(BIC_values[j]) + pow(10,-20)) ;	
+    } 
+    if(not HIT and start > 0 ){
+      vector<double> row = {start , x[j-1]*ns+offset, rB/rN , rF/rN, rR/rN  };
+      HITS.push_back(row);
+      start=-1, rN=0.0 , rF=0.0, rR=0.0, rB=0.0;
+    } 		
+  }
+  for (int j = 0; j < HITS.size();j++){
+    bounds.push_back(HITS[j]);	
+  }
+  bounds 	= merge(bounds, window*0.5);    
+}
+
+/**
+ * @brief Hand a segment's scores to the -scores writer: bin j covers
+ * X[j-1] ... X[j] in genome coordinates, j = 1 ... XN-2 (nan as 0).
+ */
+static void push_scores(segment * S, const double * BIC_values, double ns, score_writer * scores){
+  score_block B;
+  B.chrom 	= S->chrom;
+  int n 	= max(int(S->XN) - 2, 0);
+  for (int j = 0; j <= n and n > 0; j++){
+    B.edges.push_back(int(S->X[0][j]*ns+S->start));
+  }
+  for (int j = 1; j <= n; j++){
+    B.values.push_back(std::isnan(double(BIC_values[j])) ? 0 : BIC_values[j]);
+  }
+  scores->push(B);
+}
+
 //================================================================================================
 /* Function: run_global_template_matching
  *
@@ -145,13 +360,22 @@ bool check_hit(double a, double b, double c, double x, double y, double z){
  *   out_dir
  *   P      parameters for this run
  *   SC     slice_ratio ?!?!
+ *   scores every bin's ratio (of the first template) goes here, and no
+ *          window is skipped (NULL for none)
+ *   store  every bin's ratios and window sums are saved here; windows are
+ *          only skipped on coverage, which does not depend on -bct (NULL
+ *          for none)
+ *   load   per-thread scan work is added here (NULL to skip)
  *
  * Assumptions:
+ *   in the bidir module, each -templates entry is scored in the same
+ *   pass and its hits go to segment::bank_bounds (same threshold)
  *
  * Returns: 
  */
 double run_global_template_matching(vector<segment*> segments, 
-				    string out_dir,  params * P, slice_ratio SC){
+				    string out_dir,  params * P, slice_ratio SC, score_writer * scores,
+				    scan_store_writer * store, scan_load * load){
 	
   double CTT                    = 5; //filters for low coverage regions, WHY hard coded?!!?
 
@@ -159,22 +383,33 @@ double run_global_template_matching(vector<segment*> segments,
   double window 		= stod(P->p["-pad"])/ns;
   double sigma, lambda, foot_print, pi, w;
   double ct 			= stod(P->p["-bct"]);
+  double step 			= stod(P->p["-br"])/ns;
   
-  sigma 	= stod(P->p["-sigma"])/ns , lambda= ns/stod(P->p["-lambda"]);
-  foot_print= stod(P->p["-foot_print"])/ns , pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
-  
-  bool SCORES 		= not P->p["-scores"].empty();
-  
-  ofstream FHW_scores;
-  
-  if (SCORES){ FHW_scores.open(P->p["-scores"]); }
-  string annotation;
-  int prev, prev_start, stop;
-  int N;
-  int start, center;
+  pi= stod(P->p["-pi"]), w= stod(P->p["-w"]);
+  // -sigma, -lambda, -foot_print first, then the -templates bank
+  vector<vector<string> > bank;
+  if (P->bidir){
+    P->template_bank(bank);
+  }
+  bank.insert(bank.begin(), {P->p["-sigma"], P->p["-lambda"], P->p["-foot_print"]});
+  int NT 		= bank.size();
+  bool SCORES 		= scores != NULL;
+  int coarse 		= stoi(P->p["-coarse"]);
+  vector<const template_scan *> T, C;	// C: coarse first pass; not with -scores or a store, which need every bin
+  for (int b = 0; b < NT; b++){
+    sigma 	= stod(bank[b][0])/ns , lambda= ns/stod(bank[b][1]);
+    foot_print= stod(bank[b][2])/ns;
+    T.push_back(new template_scan(step, window, sigma, lambda, foot_print, pi, w));
+    if (coarse > 1 and not SCORES and store == NULL){
+      C.push_back(new template_scan(coarse*step, window, sigma, lambda, foot_print, pi, w));
+    }
+  }
 
   for (int i = 0; i < segments.size(); i++){
-    double * BIC_values 	= new double[int(segments[i]->XN)];
+    vector<double *> BIC_values(NT);
+    for (int b = 0; b < NT; b++){
+      BIC_values[b] 		= new double[int(segments[i]->XN)];
+    }
     double * densities 		= new double[int(segments[i]->XN)];
     double * densities_r 	= new double[int(segments[i]->XN)];
 
@@ -183,50 +418,39 @@ double run_global_template_matching(vector<segment*> segments,
     double er 		= segments[i]->rN*( 2*(window*ns)*0.05 /(l*ns ));
     double stdf 	= sqrt(ef*(1- (  2*(window*ns)*0.05/(l*ns )  ) )  );
     double stdr 	= sqrt(er*(1- (  2*(window*ns)*0.05 /(l*ns ) ) )  );
-    BIC_template(segments[i],  BIC_values, densities, densities_r, window, sigma, lambda, foot_print, pi, w);   
-    double start=-1, rN=0.0 , rF=0.0, rR=0.0, rB=0.0;
-    vector<vector<double>> HITS;
-    for (int j = 1; j<segments[i]->XN-1; j++){
-      if (SCORES){
-        double vl 	= BIC_values[j];
-        if (std::isnan(double(vl))){
-          vl 		= 0;
-        }
-        FHW_scores<<segments[i]->chrom<<"\t"<<to_string(int(segments[i]->X[0][j-1]*ns+segments[i]->start))<<"\t";
-        FHW_scores<<to_string(int(segments[i]->X[0][j]*ns+segments[i]->start ))<<"\t" <<to_string(vl)<<endl;
-      }
-      bool HIT = check_hit(BIC_values[j], densities[j], densities_r[j], SC.threshold, ef + CTT*stdf, er + CTT*stdr  );
-      if ( HIT ) {
-        if (start < 0){
-          start = segments[i]->X[0][j-1]*ns+segments[i]->start;
-        }
-        start+=1, rN+=1 , rF+=densities[j], rR+=densities_r[j], rB+=log10( SC.pvalue(BIC_values[j]) + pow(10,-20)) ;	
-      } 
-      if(not HIT and start > 0 ){
-        vector<double> row = {start , segments[i]->X[0][j-1]*ns+segments[i]->start, rB/rN , rF/rN, rR/rN  };
-        HITS.push_back(row);
-        start=-1, rN=0.0 , rF=0.0, rR=0.0, rB=0.0;
-      } 		
-    }
-    for (int j = 0; j < HITS.size();j++){
-      segments[i]->bidirectional_bounds.push_back(HITS[j]);	
-    }
-    segments[i]->bidirectional_bounds 	= merge(segments[i]->bidirectional_bounds, window*0.5);    
+    scan_cut cut;	// what check_hit() asks of a window
+    cut.f = ef + CTT*stdf, cut.r = er + CTT*stdr, cut.bic = SC.threshold;
+    scan_cut prune 	= cut;
+    if (store != NULL){
+      prune.bic 	= 0;	// no bounds: the saved ratios must hold for any threshold
+    }
+    BIC_template(segments[i],  BIC_values, densities, densities_r, window, T, SCORES ? NULL : &prune, C, load);   
+    if (SCORES){
+      push_scores(segments[i], BIC_values[0], ns, scores);
+    }
+    const double * x 	= segments[i]->X[0];
+    int XN 		= int(segments[i]->XN);
+    if (store != NULL){
+      store->add(segments[i]->chrom, segments[i]->start, x, XN, BIC_values, densities, densities_r, cut.f, cut.r);
+    }
+    collect_hits(x, XN, segments[i]->start, BIC_values[0], densities, densities_r, SC, cut.f, cut.r, window, ns,
+		 segments[i]->bidirectional_bounds);
+    segments[i]->bank_bounds.resize(NT-1);
+    for (int b = 1; b < NT; b++){
+      collect_hits(x, XN, segments[i]->start, BIC_values[b], densities, densities_r, SC, cut.f, cut.r, window, ns,
+		   segments[i]->bank_bounds[b-1]);
+    }
+    for (int b = 0; b < NT; b++){
+      delete [] BIC_values[b];
+    }
+    delete [] densities;
+    delete [] densities_r;
+  }
+  for (int b = 0; b < NT; b++){
+    delete T[b];
+  }
+  for (int b = 0; b < C.size(); b++){
+    delete C[b];
   }
   return 1.0;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -16,14 +16,44 @@
 #include "FDR.h"
 #include "load.h"
 #include "read_in_parameters.h"
+#include "scan_store.h"
+#include "score_writer.h"
 
 using namespace std;
 
+#define SCAN_TILE 2048	// bins per unit of work in the template scan
+#define COARSE_MARGIN 0.1	// -coarse: blocks scoring this far below the threshold are skipped (measured, see coarse_candidates)
+
+/**
+ * @brief Per-thread work done by the template scan, to check its balance.
+ */
+class scan_load{
+public:
+	vector<double> seconds;		// busy time of each thread
+	vector<long> tiles, bins, scored;	// tiles taken, bins visited, windows scored
+	vector<long> cut, bounded;	// windows skipped on coverage, on the BIC bound
+	vector<long> coarse;	// bins the -coarse pass left out
+	void resize(int);
+	string report();
+};
+
+/**
+ * @brief What a window needs to be a hit: more than f forward and r reverse
+ * reads and a BIC ratio above bic.  Windows that cannot be are not scored.
+ */
+class scan_cut{
+public:
+	double f, r, bic;
+};
+
 vector<double> peak_bidirs(segment * );
 int sample_centers(vector<double>, double);
 void noise_global_template_matching(vector<segment*>, double);
 
-double run_global_template_matching(vector<segment*> , string,  params * ,slice_ratio );
+double run_global_template_matching(vector<segment*> , string,  params * ,slice_ratio, score_writer *,
+				    scan_store_writer *, scan_load * );
+void collect_hits(const double *, int, double, const double *, const double *, const double *,
+		  slice_ratio &, double, double, double, double, vector<vector<double> > &);
 void EX(vector<segment*> , double, double , double & , double &);
 
 extern double INF;
@@ -0,0 +1,183 @@
+/**
+ * @file template_scan.cpp
+ * @author Robin Dowell
+ * @brief Table driven evaluation of the bidirectional template score (BIC3).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "template_scan.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "BIC.h"
+#include "model.h"
+#include "template_matching.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor: series tables of the template on the bin lattice.
+ * @param step lattice spacing of the scaled bin coordinates (-br/-ns)
+ * @param window half width of the scan window (-pad/-ns)
+ * @param sigma, lambda, fp, pi, w template parameters, scaled as for BIC3
+ */
+template_scan::template_scan(double step, double window, double sigma, double lambda,
+		double fp, double pi, double w)
+	: K(emg_kernel::get(step, sigma, lambda, fp, int(ceil(window/step)) + 1)){
+	this->step 	= step, this->window = window, this->pi = pi, this->w = w;
+	D 			= K.D;
+	series 		= w > 0 and w < 1 and pi > 0 and pi < 1;
+	// A/B of a window 2*window wide holding as many forward as reverse reads
+	rho0[0] 	= series ? w*0.5*(2*window) / ((1-w)*pi) : 0;
+	rho0[1] 	= series ? w*0.5*(2*window) / ((1-w)*(1-pi)) : 0;
+	for (int s = 0; s < 2; s++){
+		L0[s].resize(2*D+1), u[s].resize(2*D+1);
+		hmax[s] 	= 0;
+		for (int d = 0; d <= 2*D; d++){
+			double v 	= K.p[s][d];
+			hmax[s] 	= max(hmax[s], v);
+			L0[s][d] 	= log1p(rho0[s]*v);
+			u[s][d] 	= rho0[s]*v / (1 + rho0[s]*v);
+		}
+	}
+}
+
+/**
+ * @brief Lattice index of every bin coordinate.
+ * @param x bin coordinates (segment::X[0])
+ * @param n number of bins
+ * @param L filled with round(x/step), cleared if some x is off the lattice
+ * @return false if some bin is off the lattice
+ */
+bool template_scan::lattice(const double * x, int n, vector<int> & L) const {
+	L.resize(n);
+	for (int m = 0; m < n; m++){
+		double q 	= x[m]/step;
+		L[m] 		= int(lround(q));
+		if (fabs(q - L[m]) > 1e-6){
+			L.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief BIC3() of the window j ... k-1 around bin i, from the tables.
+ * @param X binned coverage (segment::X)
+ * @param L lattice indices of X[0] from lattice(), empty to use BIC3 with K
+ * @param j first bin of the window
+ * @param k one past the last bin (x[k] is the window's right edge)
+ * @param i center bin
+ * @param N_pos, N_neg forward and reverse coverage of the window
+ * @return the BIC ratio of the template vs. uniform noise
+ */
+double template_scan::BIC(const bin_matrix & X, const vector<int> & L, int j, int k, int i,
+		double N_pos, double N_neg) const {
+	if (L.empty() or j >= k or L[j] - L[i] < -D or L[k-1] - L[i] > D){
+		return BIC3(X, K, j, k, i, N_pos, N_neg, pi, w);
+	}
+	const double * x 	= X[0], * f = X[1], * r = X[2];
+	double N 		= N_pos + N_neg;
+	double l 		= x[k] - x[j];
+	double uni_ll 	= LOG(pi/l)*N_pos + LOG((1-pi)/l)*N_neg;
+	double pi2 		= (N_pos+10000) / (N_neg + N_pos+20000);
+	double A[2] 	= {w*pi2, w*(1-pi2)};
+	double B[2] 	= {(1-w)*pi/l, (1-w)*(1-pi)/l};
+
+	// terms needed for log(1 + delta*u), u < 1, per strand
+	double c[2][SCAN_TERMS+1];
+	int n[2] 		= {0, 0};
+	bool fits 		= series;
+	for (int s = 0; s < 2 and fits; s++){
+		double delta 	= (A[s]/B[s]) / rho0[s] - 1;
+		double t 		= 1;	// delta^n
+		do {
+			n[s]++;
+			t 			*= delta;
+			c[s][n[s]] 	= ((n[s] % 2) ? t : -t) / n[s];	// (-1)^(n+1) delta^n / n
+		} while (n[s] < SCAN_TERMS and fabs(t*delta)/(n[s]+1) > SCAN_TOLERANCE);
+		fits 	= fabs(t*delta)/(n[s]+1) <= SCAN_TOLERANCE;
+	}
+	if (not fits){
+		return BIC3(X, K, j, k, i, N_pos, N_neg, pi, w);
+	}
+	double ll = 0, F = 0, R = 0;
+	const double * u0 = &u[0][0], * u1 = &u[1][0], * l0 = &L0[0][0], * l1 = &L0[1][0];
+	int o 	= D - L[i];
+	for (int m = j; m < k; m++){
+		int d 	= L[m] + o;
+		double a = 0, b = 0;
+		for (int q = n[0]; q > 0; q--){
+			a 	= (a + c[0][q])*u0[d];
+		}
+		for (int q = n[1]; q > 0; q--){
+			b 	= (b + c[1][q])*u1[d];
+		}
+		ll 	+= (l0[d] + a)*f[m] + (l1[d] + b)*r[m];
+		F 	+= f[m], R += r[m];
+	}
+	double emg_ll 	= log(B[0])*F + log(B[1])*R + ll;
+	return (-2*uni_ll + LOG(N)) / (-2*emg_ll + 20*LOG(N));
+}
+
+/**
+ * @brief An upper bound on BIC() from the coverage weighted mean template
+ * densities hf, hr of a window (Jensen: log is concave, so the window's
+ * emg_ll is at most N_pos*log(A*hf + B) + N_neg*log(A*hr + B)).
+ * @param l window width, x[k] - x[j]
+ * @param N_pos, N_neg forward and reverse coverage of the window
+ * @param hf, hr mean density under the forward and reverse reads (or more)
+ * @return the bound, INF if there is none
+ */
+double template_scan::mean_bound(double l, double N_pos, double N_neg, double hf, double hr) const {
+	if (not series){	// some bins may have no density and are left out of emg_ll
+		return INF;
+	}
+	double N 		= N_pos + N_neg;
+	double uni_ll 	= LOG(pi/l)*N_pos + LOG((1-pi)/l)*N_neg;
+	double pi2 		= (N_pos+10000) / (N_neg + N_pos+20000);
+	double top 		= N_pos*log(w*pi2*hf + (1-w)*pi/l) + N_neg*log(w*(1-pi2)*hr + (1-w)*(1-pi)/l);
+	double low 		= -2*top + 20*LOG(N);	// <= the denominator of BIC()
+	double num 		= -2*uni_ll + LOG(N);
+	if (not (low > 0) or not isfinite(num)){
+		return INF;
+	}
+	return num > 0 ? num/low : 0;
+}
+
+/**
+ * @brief An upper bound on BIC() of any window on the lattice with this
+ * width and coverage: every read sits where the template peaks.  O(1).
+ * @param l window width, x[k] - x[j]
+ * @param N_pos, N_neg forward and reverse coverage of the window
+ * @return the bound, INF if there is none
+ */
+double template_scan::bound(double l, double N_pos, double N_neg) const {
+	return mean_bound(l, N_pos, N_neg, hmax[0], hmax[1]);
+}
+
+/**
+ * @brief An upper bound on BIC() of the window j ... k-1 around bin i, from
+ * the template densities under its reads: one multiply-add per bin and
+ * strand, within a few percent of BIC().
+ * @param X, L, j, k, i, N_pos, N_neg as for BIC()
+ * @return the bound, INF if there is none
+ */
+double template_scan::bound(const bin_matrix & X, const vector<int> & L, int j, int k, int i,
+		double N_pos, double N_neg) const {
+	if (L.empty() or j >= k or L[j] - L[i] < -D or L[k-1] - L[i] > D){
+		return INF;
+	}
+	const double * f = X[1], * r = X[2], * h0 = &K.p[0][0], * h1 = &K.p[1][0];
+	int o 	= D - L[i];
+	double F = 0, R = 0;
+	for (int m = j; m < k; m++){
+		F 	+= f[m]*h0[L[m] + o];
+		R 	+= r[m]*h1[L[m] + o];
+	}
+	return mean_bound(X[0][k] - X[0][j], N_pos, N_neg, F/N_pos, R/N_neg);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file template_scan.h
+ * @author Robin Dowell
+ * @brief Table driven evaluation of the bidirectional template score (BIC3).
+ * With -sigma, -lambda, -foot_print, -pi and -w fixed, the EMG density of a
+ * bin only depends on its offset from the window center, and bins sit on the
+ * -br/-ns lattice, so the density comes from the shared emg_kernel table.  The window's
+ * log likelihood is then a dot product of the window's coverage with
+ * log(A*h(d) + B), where only A and B change from center to center:
+ *
+ *   log(A*h + B) = log(B) + log(1 + rho0*h) + log(1 + delta*u),
+ *   rho = A/B = rho0*(1 + delta),  u = rho0*h/(1 + rho0*h) in [0, 1)
+ *
+ * rho0 is rho of a full window with balanced strands, so delta is small for
+ * almost every center and log(1 + delta*u) is a short power series in the
+ * tabulated u.  No erfc, exp or log is evaluated per bin; centers with a
+ * large delta fall back to the table driven BIC3 (one log per bin).
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef template_scan_H
+#define template_scan_H
+
+#include <vector>
+
+#include "bin_matrix.h"
+#include "emg_kernel.h"
+
+using namespace std;
+
+#define SCAN_TERMS 12		//!< most terms of the log(1 + delta*u) series
+#define SCAN_TOLERANCE 1e-14	//!< bound on the series' truncation error per unit coverage
+#define BOUND_SLACK 1e-9	//!< margin for rounding when comparing bound() to a threshold
+
+/**
+ * @brief Series tables for one template, shared read only by all threads.
+ */
+class template_scan{
+public:
+	double step;	//!< lattice spacing of bin coordinates (-br/-ns)
+	double window;	//!< half width of the scan window (-pad/-ns)
+	double pi, w;	//!< strand bias and EMG weight of the template
+	int D;			//!< tables cover offsets -D ... D lattice steps
+	const emg_kernel & K;	//!< EMG densities on the lattice
+
+	// Constructors
+	template_scan(double, double, double, double, double, double, double);	// step, window, sigma, lambda, fp, pi, w
+
+	/* FUNCTIONS: */
+	bool lattice(const double *, int, vector<int> &) const;	// bin coordinates -> lattice indices
+	double BIC(const bin_matrix &, const vector<int> &, int, int, int, double, double) const;
+	double bound(double, double, double) const;	// window width, N_pos, N_neg
+	double bound(const bin_matrix &, const vector<int> &, int, int, int, double, double) const;
+
+private:
+	bool series;	//!< the series may be used (0 < w < 1, 0 < pi < 1)
+	double rho0[2];	//!< reference ratio A/B per strand (forward, reverse)
+	vector<double> L0[2];	//!< log(1 + rho0*h) at offset d + D, h from K
+	vector<double> u[2];	//!< rho0*h/(1 + rho0*h)
+	double hmax[2];	//!< largest density on the lattice per strand
+
+	double mean_bound(double, double, double, double, double) const;
+	template_scan(const template_scan &);
+	template_scan & operator=(const template_scan &);
+};
+
+#endif
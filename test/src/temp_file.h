@@ -0,0 +1,41 @@
+/**
+ * @file temp_file.h
+ * @author Robin Dowell
+ * @brief Unit Testing: temporary input files shared by the reader tests
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#ifndef temp_file_H
+#define temp_file_H
+
+#include "gmock/gmock.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+/**
+ * @brief Write data to a new file under /tmp.
+ * @param data file contents (may be binary)
+ * @return its path; "" and a test failure if it couldn't be written in full
+ */
+static inline std::string write_temp(const std::string & data){
+    char path[] = "/tmp/tfit_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0){
+        ADD_FAILURE() << "couldn't create a temporary file";
+        return "";
+    }
+    bool ok = write(fd, data.data(), data.size()) == ssize_t(data.size());
+    ok = (close(fd) == 0) and ok;
+    if (not ok){
+        ADD_FAILURE() << "couldn't write " << path;
+        unlink(path);
+        return "";
+    }
+    return std::string(path);
+}
+
+#endif
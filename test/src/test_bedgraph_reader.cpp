@@ -0,0 +1,112 @@
+/**
+ * @file test_bedgraph_reader.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/bedgraph_reader.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "bedgraph_reader.h"
+#include "temp_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+TEST(BedgraphReader, ParsesLine)
+{
+    // Arrange
+    const char * line = "chr1\t100\t125\t-3.5";
+    bg_record rec;
+    // Act
+    bool ok = parse_bedgraph_line(line, line + strlen(line), rec);
+    // Assert
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(rec.chrom == string("chr1"));
+    EXPECT_EQ(rec.start, 100);
+    EXPECT_EQ(rec.stop, 125);
+    EXPECT_EQ(rec.coverage, -3.5);
+    EXPECT_EQ(rec.columns, 4);
+}
+
+TEST(BedgraphReader, RejectsWrongColumns)
+{
+    const char * line = "chr1\t100\t125\t3\textra";
+    bg_record rec;
+    EXPECT_FALSE(parse_bedgraph_line(line, line + strlen(line), rec));
+    EXPECT_EQ(rec.columns, 5);
+    EXPECT_EQ(rec.line.str(), string(line));
+}
+
+TEST(BedgraphReader, DoubleMatchesStod)
+{
+    const char * values[] = {"0.1", "1e-5", "123456.789", "-0.000123",
+        "3.14159265358979323846", "1e300", "7", "2.5E+3"};
+    for (int i = 0; i < 8; i++){
+        double v = 0;
+        EXPECT_TRUE(parse_double(values[i], values[i] + strlen(values[i]), v));
+        EXPECT_EQ(v, stod(values[i]));
+    }
+}
+
+TEST(BedgraphReader, ReadsMappedFile)
+{
+    // Arrange
+    string path = write_temp("chr1\t0\t10\t2\nchr1\t10\t20\t-1\r\nchr2\t5\t6\t0.5");
+    bedgraph_reader FH;
+    bg_record rec;
+    // Act
+    ASSERT_TRUE(FH.open(path));
+    int n = 0;
+    double total = 0;
+    size_t second = 0;
+    while (FH.next(rec)){
+        EXPECT_TRUE(rec.valid);
+        total += rec.coverage;
+        n++;
+        if (n == 1){ second = FH.offset(); }
+    }
+    // re-read only the second line
+    FH.seek(second, second + 15);
+    ASSERT_TRUE(FH.next(rec));
+    // Assert
+    EXPECT_EQ(n, 3);
+    EXPECT_EQ(total, 1.5);
+    EXPECT_EQ(rec.start, 10);
+    EXPECT_EQ(rec.coverage, -1);
+    EXPECT_FALSE(FH.next(rec));
+    unlink(path.c_str());
+}
+
+TEST(BedgraphReader, AttachedReadersSplitAtLines)
+{
+    // Arrange
+    string path = write_temp("chr1\t0\t10\t2\nchr1\t10\t20\t-1\nchr2\t5\t6\t0.5\n");
+    bedgraph_reader FH, A, B;
+    bg_record rec;
+    ASSERT_TRUE(FH.open(path));
+    // Act
+    size_t mid = FH.line_start(FH.size()/2);
+    ASSERT_TRUE(A.attach(FH));
+    ASSERT_TRUE(B.attach(FH));
+    A.seek(0, mid);
+    B.seek(mid, FH.size());
+    int n = 0;
+    while (A.next(rec)){ n++; }
+    // Assert
+    EXPECT_EQ(FH.line_start(0), 0);
+    EXPECT_EQ(FH.line_start(1), 12);
+    EXPECT_EQ(FH.line_start(12), 12);
+    EXPECT_EQ(mid, 26);
+    EXPECT_EQ(n, 2);
+    ASSERT_TRUE(B.next(rec));
+    EXPECT_TRUE(rec.chrom == "chr2");
+    EXPECT_FALSE(B.next(rec));
+    A.close();
+    EXPECT_TRUE(FH.next(rec));     // still open after an attached reader closes
+    unlink(path.c_str());
+}
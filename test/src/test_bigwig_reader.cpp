@@ -0,0 +1,126 @@
+/**
+ * @file test_bigwig_reader.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/bigwig_reader.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "bigwig_reader.h"
+#include "temp_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+using namespace std;
+
+template <class T> static void put(string & s, T v){
+    s.append((const char *)&v, sizeof(v));
+}
+
+/**
+ * Smallest bigWig holding one data block (raw, 24 byte header + items) on
+ * chromosome id 0, with a one leaf chromosome tree and R-tree.
+ */
+static string write_bigwig(const string & chrom, uint32_t size, const string & block,
+        uint32_t start, uint32_t end, bool compress){
+    string body = block;
+    if (compress){
+        uLongf n = compressBound(block.size());
+        body.resize(n);
+        compress2((Bytef *)&body[0], &n, (const Bytef *)block.data(), block.size(), 6);
+        body.resize(n);
+    }
+    uint64_t tree = 64, data = tree + 32 + 4 + chrom.size() + 8;
+    uint64_t index = data + 4 + body.size();
+    string f;
+    put<uint32_t>(f, BW_MAGIC); put<uint16_t>(f, 4); put<uint16_t>(f, 0);
+    put<uint64_t>(f, tree); put<uint64_t>(f, data); put<uint64_t>(f, index);
+    put<uint16_t>(f, 0); put<uint16_t>(f, 0); put<uint64_t>(f, 0); put<uint64_t>(f, 0);
+    put<uint32_t>(f, compress ? block.size() : 0); put<uint64_t>(f, 0);
+    // chromosome B+ tree: header, one leaf
+    put<uint32_t>(f, BW_CHROM_MAGIC); put<uint32_t>(f, 1); put<uint32_t>(f, chrom.size());
+    put<uint32_t>(f, 8); put<uint64_t>(f, 1); put<uint64_t>(f, 0);
+    put<uint8_t>(f, 1); put<uint8_t>(f, 0); put<uint16_t>(f, 1);
+    f += chrom; put<uint32_t>(f, 0); put<uint32_t>(f, size);
+    // data
+    put<uint32_t>(f, 1);
+    f += body;
+    // R-tree: header, one leaf
+    put<uint32_t>(f, BW_INDEX_MAGIC); put<uint32_t>(f, 256); put<uint64_t>(f, 1);
+    put<uint32_t>(f, 0); put<uint32_t>(f, start); put<uint32_t>(f, 0); put<uint32_t>(f, end);
+    put<uint64_t>(f, index); put<uint32_t>(f, 1); put<uint32_t>(f, 0);
+    put<uint8_t>(f, 1); put<uint8_t>(f, 0); put<uint16_t>(f, 1);
+    put<uint32_t>(f, 0); put<uint32_t>(f, start); put<uint32_t>(f, 0); put<uint32_t>(f, end);
+    put<uint64_t>(f, data + 4); put<uint64_t>(f, body.size());
+
+    return write_temp(f);
+}
+
+static string block_header(uint32_t start, uint32_t end, uint32_t step, uint32_t span,
+        uint8_t type, uint16_t count){
+    string b;
+    put<uint32_t>(b, 0); put<uint32_t>(b, start); put<uint32_t>(b, end);
+    put<uint32_t>(b, step); put<uint32_t>(b, span);
+    put<uint8_t>(b, type); put<uint8_t>(b, 0); put<uint16_t>(b, count);
+    return b;
+}
+
+TEST(BigwigReader, ReadsCompressedBedGraphBlock)
+{
+    // Arrange
+    string b = block_header(100, 130, 0, 0, 1, 2);
+    put<uint32_t>(b, 100); put<uint32_t>(b, 110); put<float>(b, 2.5);
+    put<uint32_t>(b, 120); put<uint32_t>(b, 130); put<float>(b, -1);
+    string bw = write_bigwig("chr1", 1000, b, 100, 130, true);
+    bigwig_reader BW;
+    vector<bw_item> items;
+    // Act
+    ASSERT_TRUE(bigwig_reader::is_bigwig(bw));
+    ASSERT_TRUE(BW.open(bw));
+    vector<bw_block> B = BW.blocks(BW.find("chr1"), 0, 1000);
+    // Assert
+    EXPECT_EQ(BW.chroms(), 1);
+    EXPECT_EQ(BW.name(0), "chr1");
+    EXPECT_EQ(BW.size(0), 1000u);
+    EXPECT_EQ(BW.find("chr2"), -1);
+    ASSERT_EQ(B.size(), 1u);
+    EXPECT_EQ(B[0].start, 100u);
+    EXPECT_EQ(B[0].end, 130u);
+    ASSERT_TRUE(BW.read(B[0], items));
+    ASSERT_EQ(items.size(), 2u);
+    EXPECT_EQ(items[0].end, 110u);
+    EXPECT_EQ(items[0].value, 2.5);
+    EXPECT_EQ(items[1].start, 120u);
+    EXPECT_EQ(items[1].value, -1);
+    BW.close();
+    unlink(bw.c_str());
+}
+
+TEST(BigwigReader, FixedStepAndRegionLookups)
+{
+    // Arrange: values 1, 2, 3 over [50,55), [60,65), [70,75), not compressed
+    string b = block_header(50, 75, 10, 5, 3, 3);
+    put<float>(b, 1); put<float>(b, 2); put<float>(b, 3);
+    string bw = write_bigwig("chrX", 500, b, 50, 75, false);
+    bigwig_reader BW;
+    vector<bw_item> items;
+    ASSERT_TRUE(BW.open(bw));
+    // Act
+    vector<bw_block> none = BW.blocks(0, 75, 500);
+    vector<bw_block> some = BW.blocks(0, 74, 500);
+    // Assert
+    EXPECT_TRUE(none.empty());
+    ASSERT_EQ(some.size(), 1u);
+    ASSERT_TRUE(BW.read(some[0], items));
+    ASSERT_EQ(items.size(), 3u);
+    EXPECT_EQ(items[1].start, 60u);
+    EXPECT_EQ(items[1].end, 65u);
+    EXPECT_EQ(items[2].value, 3);
+    EXPECT_FALSE(bigwig_reader::is_bigwig("/nonexistent"));
+    unlink(bw.c_str());
+}
@@ -0,0 +1,58 @@
+/**
+ * @file test_bin_matrix.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/bin_matrix.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "bin_matrix.h"
+
+#include <stdint.h>
+
+#include <utility>
+
+using namespace std;
+
+TEST(BinMatrix, RowsAreAlignedAndZeroed)
+{
+    // Arrange
+    bin_matrix X(3, 13);
+    // Act
+    bin_span f = X.row(1);
+    // Assert
+    EXPECT_EQ(X.rows(), 3);
+    EXPECT_EQ(X.size(), 13);
+    EXPECT_EQ(f.size(), 13);
+    for (int r = 0; r < 3; r++){
+        EXPECT_EQ(uintptr_t(X[r]) % bin_matrix::ALIGN, 0u);
+        for (int i = 0; i < 13; i++){
+            EXPECT_EQ(X[r][i], 0.0);
+        }
+    }
+}
+
+TEST(BinMatrix, CopyMoveAndShrink)
+{
+    // Arrange
+    bin_matrix X(3, 20);
+    for (int i = 0; i < 20; i++){
+        X[0][i] = i, X[1][i] = 2*i, X[2][i] = 3*i;
+    }
+    // Act
+    bin_matrix C(X);
+    bin_matrix M(std::move(X));
+    M.shrink(5);
+    // Assert
+    EXPECT_TRUE(X.empty());
+    EXPECT_EQ(C.size(), 20);
+    EXPECT_EQ(C[2][19], 57.0);
+    EXPECT_EQ(M.size(), 5);
+    EXPECT_EQ(uintptr_t(M[2]) % bin_matrix::ALIGN, 0u);
+    double S = 0;
+    for (double v : M.row(2)){
+        S += v;
+    }
+    EXPECT_EQ(S, 30.0);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file test_coverage_bins.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/coverage_bins.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "coverage_bins.h"
+
+#include <math.h>
+
+using namespace std;
+
+TEST(CoverageBins, SplitsRunsAcrossBins)
+{
+    // Arrange
+    coverage_bins B;
+    B.reset(10, NAN, false);
+    // Act
+    B.add(1, 100, 125, 2);     // bases 100..124
+    B.add(-1, 118, 121, 1);    // bases 118..120
+    // Assert
+    EXPECT_EQ(B.origin, 100);
+    ASSERT_EQ(B.forward.size(), 3);
+    EXPECT_EQ(B.forward[0], 20);
+    EXPECT_EQ(B.forward[1], 20);
+    EXPECT_EQ(B.forward[2], 10);
+    ASSERT_EQ(B.reverse.size(), 3);
+    EXPECT_EQ(B.reverse[1], 2);
+    EXPECT_EQ(B.reverse[2], 1);
+    EXPECT_EQ(B.hi, 124);
+}
+
+TEST(CoverageBins, MovesOriginByWholeBins)
+{
+    coverage_bins B;
+    B.reset(10, NAN, false);
+    B.add(1, 100, 101, 1);
+    B.add(1, 80, 81, 1);       // two bins to the left, on the lattice
+    EXPECT_FALSE(B.misaligned);
+    EXPECT_EQ(B.origin, 80);
+    ASSERT_EQ(B.forward.size(), 3);
+    EXPECT_EQ(B.forward[0], 1);
+    EXPECT_EQ(B.forward[2], 1);
+    B.add(-1, 75, 76, 1);      // off the lattice
+    EXPECT_TRUE(B.misaligned);
+    EXPECT_EQ(B.lo, 75);
+}
+
+TEST(CoverageBins, FixedOriginDropsLeftBases)
+{
+    coverage_bins B;
+    B.reset(5, 10, true);
+    B.add(1, 8, 12, 1);        // bases 8, 9 are left of the origin
+    EXPECT_FALSE(B.misaligned);
+    EXPECT_EQ(B.origin, 10);
+    ASSERT_EQ(B.forward.size(), 1);
+    EXPECT_EQ(B.forward[0], 2);
+}
+
+TEST(CoverageBins, MergesPiecesOnTheLattice)
+{
+    // Arrange
+    coverage_bins whole, total, left, right;
+    whole.reset(10, 100, true);
+    total.reset(10, 100, true);
+    left.reset(10, 100, true);
+    right.reset(10, 120, true);    // two bins in
+    // Act
+    whole.add(1, 100, 125, 2);
+    whole.add(1, 125, 140, 1);
+    left.add(1, 100, 125, 2);
+    right.add(1, 125, 140, 1);
+    // Assert
+    EXPECT_TRUE(total.merge(left));
+    EXPECT_TRUE(total.merge(right));
+    EXPECT_EQ(total.forward, whole.forward);
+    EXPECT_EQ(total.hi, 139);
+    coverage_bins off;
+    off.reset(10, 95, true);
+    off.add(1, 95, 96, 1);
+    EXPECT_FALSE(total.merge(off));
+}
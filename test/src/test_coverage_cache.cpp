@@ -0,0 +1,98 @@
+/**
+ * @file test_coverage_cache.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/coverage_cache.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "coverage_cache.h"
+#include "temp_file.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+TEST(CoverageCache, RoundTripsJointBedgraph)
+{
+    // Arrange
+    string bg = write_temp("chr2\t50\t60\t-2\nchr2\t10\t20\t3\nchr1\t0\t5\t1.5\nchr1\t5\t9\t0\n");
+    string out = bg + ".tfitcov";
+    // Act
+    ASSERT_TRUE(write_coverage_cache({bg}, out));
+    coverage_cache CC;
+    ASSERT_TRUE(coverage_cache::is_cache(out));
+    ASSERT_TRUE(CC.open(out));
+    // Assert
+    EXPECT_FALSE(coverage_cache::is_cache(bg));
+    EXPECT_EQ(CC.chroms(), 2);
+    EXPECT_EQ(CC.find("chr3"), -1);
+    int c = CC.find("chr2");
+    ASSERT_EQ(c, 1);
+    EXPECT_EQ(CC.chrom(c).lo, 10);
+    EXPECT_EQ(CC.chrom(c).hi, 59);
+    EXPECT_EQ(CC.chrom(c).count[0], 1u);
+    EXPECT_EQ(CC.runs(c, 0)[0].value, 3);
+    EXPECT_EQ(CC.runs(c, 1)[0].value, 2);
+    // the zero coverage line is kept on the reverse strand
+    int c1 = CC.find("chr1");
+    EXPECT_EQ(CC.chrom(c1).count[1], 1u);
+    EXPECT_EQ(CC.chrom(c1).hi, 8);
+    CC.close();
+    unlink(bg.c_str());
+    unlink(out.c_str());
+}
+
+TEST(CoverageCache, SortsBlocksForRegionLookups)
+{
+    // Arrange
+    string f = write_temp("chr1\t100\t110\t1\nchr1\t0\t10\t2\nchr1\t200\t230\t3\n");
+    string r = write_temp("chr1\t5\t6\t4\n");
+    string out = f + ".tfitcov";
+    // Act
+    ASSERT_TRUE(write_coverage_cache({f, r}, out));
+    coverage_cache CC;
+    ASSERT_TRUE(CC.open(out));
+    const cov_run * R = CC.runs(0, 0);
+    size_t k = CC.first_run(0, 0, 150);
+    // Assert
+    EXPECT_EQ(CC.header().files, 2u);
+    EXPECT_EQ(R[0].start, 0);
+    EXPECT_EQ(R[1].start, 100);
+    EXPECT_EQ(R[2].start, 200);
+    EXPECT_LE(k, 2u);
+    EXPECT_GE(k, 1u);
+    EXPECT_EQ(CC.chrom(0).count[1], 1u);
+    CC.close();
+    unlink(f.c_str());
+    unlink(r.c_str());
+    unlink(out.c_str());
+}
+
+TEST(CoverageCache, RejectsNameOutsideFile)
+{
+    // Arrange
+    string bg = write_temp("chr1\t0\t5\t1\n");
+    string out = bg + ".tfitcov";
+    ASSERT_TRUE(write_coverage_cache({bg}, out));
+    coverage_cache CC;
+    ASSERT_TRUE(CC.open(out));
+    uint64_t at = CC.header().table + offsetof(cov_chrom, name);
+    uint64_t past = CC.header().size;
+    CC.close();
+    // Act: point the name one past the end of the file
+    FILE * FH = fopen(out.c_str(), "r+b");
+    ASSERT_TRUE(FH != NULL);
+    fseek(FH, at, SEEK_SET);
+    fwrite(&past, sizeof(past), 1, FH);
+    fclose(FH);
+    // Assert
+    EXPECT_FALSE(CC.open(out));
+    unlink(bg.c_str());
+    unlink(out.c_str());
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_em_arrays.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/em_arrays.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "em_arrays.h"
+#include "emg_batch.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Three components and noise over 1300 bins (three tiles), some of the
+ * coverage zero; the EMG windows are cut short for the last component.
+ */
+static void setup(em_arrays & E, vector<double> & x, vector<double> & f, vector<double> & r){
+    int XN = 1300;
+    mt19937 mt(11);
+    uniform_real_distribution<double> u(0, 1);
+    for (int i = 0; i < XN; i++){
+        x.push_back(i*0.25);
+        f.push_back(u(mt) < 0.3 ? 0 : floor(u(mt)*10));
+        r.push_back(u(mt) < 0.3 ? 0 : floor(u(mt)*10));
+    }
+    E.resize(3);
+    double mus[3] = {60, 150, 280};
+    for (int k = 0; k < 3; k++){
+        E.mu[k] = mus[k], E.si[k] = 1 + k, E.l[k] = 0.3 + 0.2*k, E.w[k] = 0.2;
+        E.pi[k] = 0.4 + 0.1*k, E.foot_print[k] = 0.5*k;
+        E.lo[k] = 0, E.hi[k] = XN;
+        E.u_lo[2*k] = mus[k]*4, E.u_hi[2*k] = min(XN, int(mus[k]*4) + 300);
+        E.u_lo[2*k+1] = max(0, int(mus[k]*4) - 200), E.u_hi[2*k+1] = mus[k]*4;
+        E.u_f[2*k] = 0.01*(k+1), E.u_r[2*k] = 0.002;
+        E.u_f[2*k+1] = 0.001, E.u_r[2*k+1] = 0.015*(k+1);
+    }
+    E.lo[2] = 1050, E.hi[2] = 1200;
+    E.noise_f = 1e-4, E.noise_r = 2e-4;
+}
+
+/**
+ * component::evaluate and component::add_stats one bin and one
+ * component at a time, as classifier::fit2 does.
+ */
+static double reference(const em_arrays & E, const vector<double> & x, const vector<double> & f,
+        const vector<double> & r, vector<double> & S, vector<double> & U, double noise[2]){
+    int K = E.K, XN = x.size();
+    double ll = 0;
+    S.assign(6*K, 0), U.assign(4*K, 0);
+    noise[0] = 0, noise[1] = 0;
+    for (int i = 0; i < XN; i++){
+        for (int s = 0; s < 2; s++){
+            int st = s==0 ? 1 : -1;
+            double y = s==0 ? f[i] : r[i];
+            if (not y) continue;
+            vector<double> p(K, 0), ey(K, 0), ey2(K, 0), u(2*K, 0);
+            double norm = 0;
+            for (int k = 0; k < K; k++){
+                if (E.lo[k] <= i and i < E.hi[k]){
+                    emg_params P;
+                    P.mu = E.mu[k], P.si = E.si[k], P.l = E.l[k], P.w = E.w[k], P.pi = E.pi[k];
+                    P.foot_print = E.foot_print[k];
+                    emg_batch(P, &x[i], 1, st, &p[k], &ey[k], &ey2[k]);
+                }
+                for (int v = 2*k; v < 2*k+2; v++){
+                    if (E.u_lo[v] <= i and i < E.u_hi[v]) u[v] = s==0 ? E.u_f[v] : E.u_r[v];
+                }
+                norm += p[k] + u[2*k] + u[2*k+1];
+            }
+            double nz = s==0 ? E.noise_f : E.noise_r;
+            norm += nz;
+            if (not (norm > 0)) continue;
+            ll += log(norm)*y;
+            noise[s] += nz/norm*y;
+            for (int k = 0; k < K; k++){
+                double vl = p[k]/norm;
+                S[6*k + s] += vl*y;
+                U[4*k + s] += u[2*k]/norm*y, U[4*k + 2 + s] += u[2*k+1]/norm*y;
+                if (vl > 0 and y > 0){
+                    double EX = x[i] - st*ey[k] - E.foot_print[k]*st;
+                    S[6*k + 2] += ey[k]*vl*y;
+                    S[6*k + 3] += EX*vl*y;
+                    S[6*k + 4] += (EX*EX + ey2[k] - ey[k]*ey[k])*vl*y;
+                    S[6*k + 5] += max((st*(x[i]-E.mu[k]) - ey[k])*vl*y, 0.0);
+                }
+            }
+        }
+    }
+    return ll;
+}
+
+static void expect_close(double a, double b){
+    EXPECT_NEAR(a, b, 1e-9*max(1.0, fabs(b)));
+}
+
+TEST(EmArrays, MatchesPointByPoint)
+{
+    em_arrays E;
+    vector<double> x, f, r;
+    setup(E, x, f, r);
+    double ll = E.estep(x.data(), f.data(), r.data(), x.size());
+    vector<double> S, U;
+    double noise[2];
+    double rll = reference(E, x, f, r, S, U, noise);
+    expect_close(ll, rll);
+    for (int k = 0; k < E.K; k++){
+        expect_close(E.r_f[k], S[6*k]);
+        expect_close(E.r_r[k], S[6*k + 1]);
+        expect_close(E.ey[k], S[6*k + 2]);
+        expect_close(E.ex[k], S[6*k + 3]);
+        expect_close(E.ex2[k], S[6*k + 4]);
+        expect_close(E.C[k], S[6*k + 5]);
+        expect_close(E.u_rf[2*k], U[4*k]);
+        expect_close(E.u_rr[2*k], U[4*k + 1]);
+        expect_close(E.u_rf[2*k+1], U[4*k + 2]);
+        expect_close(E.u_rr[2*k+1], U[4*k + 3]);
+    }
+    expect_close(E.noise_rf, noise[0]);
+    expect_close(E.noise_rr, noise[1]);
+}
+
+TEST(EmArrays, ResponsibilitiesSumToCoverage)
+{
+    em_arrays E;
+    vector<double> x, f, r;
+    setup(E, x, f, r);
+    E.estep(x.data(), f.data(), r.data(), x.size());
+    double total = 0, got = E.noise_rf + E.noise_rr;
+    for (size_t i = 0; i < x.size(); i++) total += f[i] + r[i];
+    for (int k = 0; k < E.K; k++){
+        got += E.r_f[k] + E.r_r[k] + E.u_rf[2*k] + E.u_rr[2*k] + E.u_rf[2*k+1] + E.u_rr[2*k+1];
+    }
+    EXPECT_NEAR(got, total, 1e-9*total);
+}
+
+TEST(EmArrays, OnePassForAllFits)
+{
+    em_arrays A, B;
+    vector<double> x, f, r, x2, f2, r2;
+    setup(A, x, f, r);
+    setup(B, x2, f2, r2);
+    B.mu[0] = 90, B.si[1] = 4, B.lo[2] = 0, B.u_hi[0] = B.u_lo[0];
+    double la = A.estep(x.data(), f.data(), r.data(), x.size());
+    double lb = B.estep(x.data(), f.data(), r.data(), x.size());
+    vector<double> ra = A.r_f, rb = B.r_f, ua = A.u_rr, ub = B.u_rr;
+    vector<em_arrays *> E = {&A, &B};
+    vector<double> ll;
+    estep_all(E, x.data(), f.data(), r.data(), x.size(), ll);
+    ASSERT_EQ(ll.size(), 2);
+    EXPECT_EQ(ll[0], la);
+    EXPECT_EQ(ll[1], lb);
+    EXPECT_EQ(A.r_f, ra);
+    EXPECT_EQ(B.r_f, rb);
+    EXPECT_EQ(A.u_rr, ua);
+    EXPECT_EQ(B.u_rr, ub);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_emg_batch.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/emg_batch.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "emg_batch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+/**
+ * EMG::pdf, EMG::EY and EMG::EY2 (model.cpp) written out with libm; the
+ * Mills ratio from erfc.
+ */
+static double mills(double x){
+    double D = exp(-x*x/2)/sqrt(2*M_PI);
+    if (x > 4) return 1.0/x;
+    if (D < 1e-15) return 1e15;
+    return 0.5*erfc(x/sqrt(2))/D;
+}
+static void reference(const emg_params & E, double z, int s, double & p, double & ey, double & ey2){
+    z -= s*E.foot_print;
+    double mu = E.mu, si = E.si, l = E.l;
+    p = (l/2)*exp((l/2)*(s*2*(mu-z) + l*si*si))*erfc((s*(mu-z) + l*si*si)/(sqrt(2)*si));
+    p *= E.w*(s == 1 ? E.pi : 1 - E.pi);
+    if (not (p < 1e7)) p = 0;
+    double R = mills(l*si - s*((z-mu)/si));
+    ey = max(0., s*(z-mu) - l*si*si + si/R);
+    ey2 = l*l*si*si*si*si + si*si*(2*l*s*(mu-z) + 1) + (mu-z)*(mu-z) - si*(l*si*si + s*(mu-z))/R;
+}
+
+static void expect_matches(void (*kernel)(const emg_params &, const double *, int, int, double *, double *, double *)){
+    emg_params E;
+    E.mu = 50, E.si = 1.5, E.l = 0.4, E.w = 0.3, E.pi = 0.7, E.foot_print = 0.86;
+    vector<double> x;
+    for (double z = 0; z <= 100; z += 0.25) x.push_back(z);    // the bin lattice
+    int n = x.size();
+    vector<double> p(n), ey(n), ey2(n);
+    for (int s = -1; s <= 1; s += 2){
+        kernel(E, x.data(), n, s, p.data(), ey.data(), ey2.data());
+        for (int i = 0; i < n; i++){
+            double rp, rey, rey2;
+            reference(E, x[i], s, rp, rey, rey2);
+            EXPECT_NEAR(p[i], rp, 1e-11*max(rp, 1e-300)) << "x " << x[i] << " strand " << s;
+            EXPECT_NEAR(ey[i], rey, 1e-11*max(fabs(rey), 1.0)) << "x " << x[i] << " strand " << s;
+            EXPECT_NEAR(ey2[i], rey2, 1e-11*max(fabs(rey2), 1.0)) << "x " << x[i] << " strand " << s;
+        }
+    }
+}
+
+TEST(EmgBatch, ScalarMatchesLibm)
+{
+    expect_matches(emg_batch_scalar);
+}
+
+TEST(EmgBatch, DispatchedMatchesLibm)
+{
+    // Whichever kernel this CPU runs
+    expect_matches(emg_batch);
+    const char * isa = emg_batch_isa();
+    EXPECT_TRUE(strcmp(isa, "avx512") == 0 or strcmp(isa, "avx2") == 0 or strcmp(isa, "scalar") == 0);
+}
+
+TEST(EmgBatch, ZeroWeightAndNoStats)
+{
+    // Arrange
+    emg_params E;
+    E.mu = 10, E.si = 1, E.l = 1, E.w = 0, E.pi = 0.5, E.foot_print = 0;
+    double x[5] = {8, 9, 10, 11, 12}, p[5];
+
+    // Act: EY and EY2 skipped
+    emg_batch(E, x, 5, 1, p, NULL, NULL);
+
+    // Assert
+    for (int i = 0; i < 5; i++){
+        EXPECT_EQ(p[i], 0.0);
+    }
+}
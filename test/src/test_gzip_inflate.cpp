@@ -0,0 +1,113 @@
+/**
+ * @file test_gzip_inflate.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/gzip_inflate.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "gzip_inflate.h"
+#include "bedgraph_reader.h"
+#include "temp_file.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+using namespace std;
+
+/**
+ * One gzip member of text; as a BGZF block (with the "BC" extra subfield)
+ * when bgzf is set.
+ */
+static string gzip_member(const string & text, bool bgzf){
+    z_stream z = {};
+    deflateInit2(&z, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    string payload(deflateBound(&z, text.size()), '\0');
+    z.next_in = (Bytef *)text.data();
+    z.avail_in = text.size();
+    z.next_out = (Bytef *)&payload[0];
+    z.avail_out = payload.size();
+    deflate(&z, Z_FINISH);
+    payload.resize(z.total_out);
+    deflateEnd(&z);
+
+    string m = "\x1f\x8b\x08";
+    m += bgzf ? '\x04' : '\x00';
+    m += string(6, '\0');
+    if (bgzf){
+        size_t bsize = 12 + 6 + payload.size() + 8 - 1;
+        m += string("\x06\x00" "BC" "\x02\x00", 6);
+        m += char(bsize & 0xff);
+        m += char(bsize >> 8);
+    }
+    m += payload;
+    uint32_t crc = crc32(0, (const Bytef *)text.data(), text.size());
+    uint32_t isize = text.size();
+    m.append((const char *)&crc, 4);
+    m.append((const char *)&isize, 4);
+    return m;
+}
+
+TEST(GzipInflate, ConcatenatedMembers)
+{
+    // Arrange: two gzip members back to back (as from cat a.gz b.gz); the
+    // second inflates to far more than the first guess at the output size
+    string big(6<<20, 'x');
+    string gz = gzip_member("chr1\t0\t10\t2\n", false) + gzip_member(big, false);
+    char * out;
+    size_t n;
+    // Act
+    bool ok = gzip_inflate(gz.data(), gz.size(), out, n);
+    // Assert
+    ASSERT_TRUE(ok);
+    EXPECT_TRUE(is_gzip(gz.data(), gz.size()));
+    EXPECT_FALSE(is_bgzf(gz.data(), gz.size()));
+    ASSERT_EQ(n, 12 + big.size());
+    EXPECT_EQ(string(out, 12), "chr1\t0\t10\t2\n");
+    EXPECT_EQ(string(out + 12, n - 12), big);
+    free(out);
+}
+
+TEST(GzipInflate, BgzfBlocksAndCorruption)
+{
+    // Arrange: three BGZF blocks and the empty end of file block
+    string bgzf = gzip_member("chr1\t0\t10\t2\n", true) + gzip_member("chr1\t10\t20\t3\n", true)
+        + gzip_member("chr2\t5\t6\t1\n", true) + gzip_member("", true);
+    string bad = bgzf;
+    bad[bad.size()/2] ^= 0x55;
+    char * out;
+    size_t n;
+    // Act
+    bool ok = gzip_inflate(bgzf.data(), bgzf.size(), out, n);
+    // Assert
+    ASSERT_TRUE(ok);
+    EXPECT_TRUE(is_bgzf(bgzf.data(), bgzf.size()));
+    EXPECT_EQ(string(out, n), "chr1\t0\t10\t2\nchr1\t10\t20\t3\nchr2\t5\t6\t1\n");
+    free(out);
+    EXPECT_FALSE(gzip_inflate(bad.data(), bad.size(), out, n));
+    EXPECT_FALSE(gzip_inflate(bgzf.data(), bgzf.size() - 20, out, n));
+}
+
+TEST(GzipInflate, ReaderOpensCompressedBedgraph)
+{
+    // Arrange
+    string gz = gzip_member("chr1\t0\t10\t2\nchr2\t5\t6\t0.5\n", true);
+    string path = write_temp(gz);
+    bedgraph_reader R;
+    bg_record rec;
+    // Act
+    ASSERT_TRUE(R.open(path));
+    // Assert
+    ASSERT_TRUE(R.next(rec));
+    EXPECT_TRUE(rec.chrom == string("chr1"));
+    EXPECT_EQ(rec.stop, 10);
+    ASSERT_TRUE(R.next(rec));
+    EXPECT_EQ(rec.coverage, 0.5);
+    EXPECT_FALSE(R.next(rec));
+    R.close();
+    unlink(path.c_str());
+}
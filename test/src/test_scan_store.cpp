@@ -0,0 +1,74 @@
+/**
+ * @file test_scan_store.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/scan_store.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "scan_store.h"
+#include "temp_file.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+
+using namespace std;
+
+TEST(ScanStore, RoundTripsSegments)
+{
+    // Arrange
+    string out = write_temp("");
+    map<string, string> options = {{"-bct", "0.95"}, {"-sigma", "123"}, {"-templates", "1,2,3"}};
+    double x1[4] = {0, 1, 2, 3.5}, f1[4] = {0, 5, 6, 0}, r1[4] = {1, 2, 3, 4};
+    double b1a[4] = {0, 0.8, 0.9, 0}, b1b[4] = {0, 0.1, 0.2, 0.3};
+    double x2[2] = {10, 11}, f2[2] = {7, 8}, r2[2] = {9, 10}, b2a[2] = {1, 2}, b2b[2] = {3, 4};
+    scan_store_writer W(out, options, 0.7, 0.1, true, 1, 2);
+    // Act
+    W.add("chr1", 100, x1, 4, {b1a, b1b}, f1, r1, 4.5, 3.5);
+    W.add("chrX", 200, x2, 2, {b2a, b2b}, f2, r2, 1, 2);
+    ASSERT_TRUE(W.close());
+    scan_store S;
+    ASSERT_TRUE(S.open(out));
+    // Assert
+    const scan_header & H = S.header();
+    EXPECT_EQ(H.templates, 2u);
+    EXPECT_EQ(H.fitted, 1u);
+    EXPECT_DOUBLE_EQ(H.mean, 0.7);
+    ASSERT_EQ(S.segments(), 2);
+    EXPECT_EQ(S.name(0), "chr1");
+    EXPECT_EQ(S.name(1), "chrX");
+    EXPECT_EQ(S.block(0).bins, 4u);
+    EXPECT_DOUBLE_EQ(S.block(0).start, 100);
+    EXPECT_DOUBLE_EQ(S.block(0).cut_f, 4.5);
+    EXPECT_DOUBLE_EQ(S.block(1).cut_r, 2);
+    EXPECT_DOUBLE_EQ(S.x(0)[3], 3.5);
+    EXPECT_DOUBLE_EQ(S.densities(0)[2], 6);
+    EXPECT_DOUBLE_EQ(S.densities_r(1)[1], 10);
+    EXPECT_DOUBLE_EQ(S.BIC(0, 0)[2], 0.9);
+    EXPECT_DOUBLE_EQ(S.BIC(1, 1)[0], 3);
+    map<string, string> saved = S.parameters();
+    EXPECT_EQ(saved, options);
+    S.close();
+    unlink(out.c_str());
+}
+
+TEST(ScanStore, RejectsTruncatedScans)
+{
+    // Arrange
+    string out = write_temp("");
+    double x[3] = {0, 1, 2}, b[3] = {0, 0, 0};
+    scan_store_writer W(out, {{"-N", "a"}}, 0, 0, false, 1, 1);
+    W.add("chr1", 0, x, 3, {b}, b, b, 0, 0);
+    ASSERT_TRUE(W.close());
+    ifstream FH(out, ios::binary);
+    string bytes((istreambuf_iterator<char>(FH)), istreambuf_iterator<char>());
+    ofstream(out, ios::binary) << bytes.substr(0, bytes.size() - 5);
+    scan_store S;
+    // Act / Assert
+    EXPECT_FALSE(S.open(out));
+    EXPECT_FALSE(S.open(out + ".missing"));
+    unlink(out.c_str());
+}
@@ -0,0 +1,112 @@
+/**
+ * @file test_score_writer.cpp
+ * @author Robin Dowell
+ * @brief Unit Testing: testing Tfit/src/score_writer.cpp
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ */
+#include "gmock/gmock.h"
+#include "score_writer.h"
+#include "temp_file.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+static string temp_path(const char * suffix){
+    string path = write_temp("");
+    unlink(path.c_str());
+    return path + suffix;
+}
+
+static score_block make_block(string chrom, vector<int32_t> edges, vector<double> values){
+    score_block B;
+    B.chrom = chrom, B.edges = edges, B.values = values;
+    return B;
+}
+
+TEST(ScoreWriter, MergesRunsThatPrintTheSameInBedgraph)
+{
+    // Arrange
+    string out = temp_path(".bg");
+    score_writer W(out);
+    score_block a = make_block("chr1", {0, 10, 20, 30, 40, 50}, {0, 0, 0.5, 0.5000001, 0.25});
+    score_block b = make_block("chr2", {5, 15}, {1});
+    // Act
+    W.push(a);
+    W.push(b);
+    ASSERT_TRUE(W.close());
+    // Assert
+    ifstream FH(out);
+    stringstream text;
+    text << FH.rdbuf();
+    EXPECT_EQ(text.str(), "chr1\t0\t20\t0.000000\nchr1\t20\t40\t0.500000\nchr1\t40\t50\t0.250000\n"
+        "chr2\t5\t15\t1.000000\n");
+    EXPECT_TRUE(a.values.empty());
+    unlink(out.c_str());
+}
+
+TEST(ScoreWriter, RoundTripsBinaryTrack)
+{
+    // Arrange
+    string out = temp_path(SCORE_EXT);
+    score_writer W(out);
+    for (int c = 0; c < 20; c++){   // more blocks than the queue holds
+        vector<int32_t> edges;
+        vector<double> values;
+        for (int i = 0; i <= 1000; i++){
+            edges.push_back(100*c + 3*i);
+        }
+        for (int i = 0; i < 1000; i++){
+            values.push_back(i % 7 < 3 ? 0 : 0.1*i);
+        }
+        score_block B = make_block("chr" + to_string(c), edges, values);
+        W.push(B);
+    }
+    score_block empty = make_block("chrE", {}, {});
+    W.push(empty);
+    // Act
+    ASSERT_TRUE(W.close());
+    vector<score_block> B;
+    ASSERT_TRUE(read_score_track(out, B));
+    // Assert
+    ASSERT_EQ(B.size(), 21u);
+    EXPECT_EQ(B[3].chrom, "chr3");
+    EXPECT_EQ(B[20].chrom, "chrE");
+    EXPECT_TRUE(B[20].values.empty());
+    // expand the runs back to bins
+    const score_block & S = B[3];
+    ASSERT_EQ(S.edges.size(), S.values.size() + 1);
+    EXPECT_EQ(S.edges.front(), 300);
+    EXPECT_EQ(S.edges.back(), 3300);
+    for (size_t r = 0; r < S.values.size(); r++){
+        for (int e = S.edges[r]; e < S.edges[r+1]; e += 3){
+            int i = (e - 300)/3;
+            EXPECT_FLOAT_EQ(S.values[r], i % 7 < 3 ? 0 : 0.1*i);
+        }
+    }
+    EXPECT_LT(S.values.size(), 1000u);
+    unlink(out.c_str());
+}
+
+TEST(ScoreWriter, RejectsOtherFiles)
+{
+    // Arrange
+    string out = temp_path(SCORE_EXT);
+    ofstream FH(out);
+    FH << "chr1\t0\t10\t1.0\n";
+    FH.close();
+    vector<score_block> B;
+    // Act / Assert
+    EXPECT_FALSE(read_score_track(out, B));
+    EXPECT_FALSE(read_score_track(out + ".missing", B));
+    score_writer W("/nonexistent/dir/x.bg");
+    EXPECT_FALSE(W.good());
+    EXPECT_FALSE(W.close());
+    unlink(out.c_str());
+}